@@ -0,0 +1,393 @@
+/*
+ * Copyright © 2011,2012,2013 Lars Lindqvist <lars.lindqvist at yandex.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Micro-benchmarks of the kernels of graph.c and lp.c, over a grid
+   of (r, k, n).  The input of every point is the non-isomorphic
+   graphs on m edges from subgraphs_on_m_edges(), so that runs are
+   reproducible.  A benchmark is repeated, doubling the number of
+   operations, until it has run for MIN_NS, and is written as one
+   JSON object with the time and the calls of g_malloc() and friends
+   per operation.  An operation is one graph for the per graph
+   kernels, and the whole input for isoreduce and batch_isoreduce. */
+
+#include "util.h"
+#include "lp.h"
+#include <time.h>
+
+#ifndef COUNT_ALLOCS
+#error "bench counts allocations, build it with make bench"
+#endif
+
+#define MIN_NS 200000000UL
+#define DEF_M 5
+
+/* (r, k, n) of the default grid */
+static const uint grid[][3] = {
+	{2, 3, 6}, {2, 4, 8}, {3, 4, 6}, {3, 5, 7}, {4, 5, 7}
+};
+
+static void
+usage(const char *prog) {
+	fprintf(stdout,
+		"usage: %s [-r# -k# -n#] [-m#] [-t#] [-o filename] [-q]\n"
+		"	optional arguments\n"
+		"	 -r, -k, -n, benchmark only this point of the grid\n"
+		"	 -m, edges of the input graphs, default %u or half of K^r_n\n"
+		"	 -t, threads of isoreduce, default one per cpu\n"
+		"	 -o, write the results to file, default stdout\n"
+		"	 -q, quiet, with -o, don't print the benchmarks as they are run\n"
+		"	output: one JSON object, with an array `results' of\n"
+		"	        name, r, k, n, m, graphs, ops, ns_per_op and allocs_per_op\n",
+		prog, DEF_M);
+
+	exit(EXIT_FAILURE);
+}
+
+typedef struct {
+	uint r, k, n, m, M;
+	Complete_graph *K, *K_p, *Kd;
+	GraphBatch *B;		/* the input */
+	GraphBatch *twice;	/* B and B relabelled, for isoreduce */
+	GraphBatch *work;	/* scratch copy of twice for batch_isoreduce */
+	Graph *views;		/* of the graphs of B */
+	char **lines;		/* the graphs of B as text */
+	FILE *text;		/* the same, for read_graph() */
+	FILE *null;		/* for the LP text */
+	ulong next;		/* graph of the next operation */
+} bench_t;
+
+typedef void (*bench_fn) (bench_t *, ulong);
+
+static Graph *
+next_graph(bench_t * b) {
+	return b->views + b->next++ % b->B->n;
+}
+
+static void
+bench_complete_graph(bench_t * b, ulong ops) {
+	while (ops--)
+		free_K(complete_graph(b->n, b->r));
+}
+
+/* The edge sets are made again every time, as for a graph just read */
+static void
+bench_complement(bench_t * b, ulong ops) {
+	Graph *g;
+
+	while (ops--) {
+		g = next_graph(b);
+		free_G(complement(g, b->K));
+		free(g->bits);
+		g->bits = NULL;
+	}
+}
+
+static void
+bench_covering_design(bench_t * b, ulong ops) {
+	Graph *g;
+
+	while (ops--) {
+		g = next_graph(b);
+		free_G(covering_design(g, b->K, b->Kd));
+		free(g->bits);
+		g->bits = NULL;
+	}
+}
+
+static void
+bench_set_s6(bench_t * b, ulong ops) {
+	Graph *g;
+
+	while (ops--) {
+		g = next_graph(b);
+		set_s6(g, b->K);
+		free(g->s6);
+		g->s6 = NULL;
+	}
+}
+
+static void
+bench_str2graph(bench_t * b, ulong ops) {
+	Graph *g;
+
+	g = Galloc(b->n, b->m);
+	while (ops--)
+		if (str2graph(b->K, g, b->lines[b->next++ % b->B->n])) {
+			errmsg("FATAL: str2graph failed\n");
+			exit(EXIT_FAILURE);
+		}
+	free_G(g);
+}
+
+static void
+bench_read_graph(bench_t * b, ulong ops) {
+	Graph *g;
+
+	while (ops--) {
+		if (!(g = read_graph(b->K, b->m, b->text))) {
+			rewind(b->text);
+			g = read_graph(b->K, b->m, b->text);
+		}
+		free_G(g);
+	}
+}
+
+/* Building the list is part of the operation, isoreduce() frees it.
+   Every class of B is in it twice. */
+static void
+bench_isoreduce(bench_t * b, ulong ops) {
+	Graph *head, *g;
+	uint i;
+
+	while (ops--) {
+		head = NULL;
+		for (i = 0; i < b->twice->n; i++) {
+			g = Galloc(b->n, b->m);
+			memcpy(g->edges, BATCH_EDGES(b->twice, i), b->m * sizeof(uint));
+			g->next = head;
+			head = g;
+		}
+		head = isoreduce(head, b->K);
+		for (i = 0, g = head; g; g = g->next)
+			i++;
+		if (i != b->B->n) {
+			errmsg("FATAL: isoreduce kept %u of %u classes\n", i, b->B->n);
+			exit(EXIT_FAILURE);
+		}
+		cleanup(head);
+	}
+}
+
+/* The same input as an in-place batch, copying it back is part of
+   the operation */
+static void
+bench_batch_isoreduce(bench_t * b, ulong ops) {
+	while (ops--) {
+		memcpy(b->work->edges, b->twice->edges, (size_t)b->twice->n * b->m * sizeof(uint));
+		b->work->n = b->twice->n;
+		batch_isoreduce(b->work, b->K);
+		if (b->work->n != b->B->n) {
+			errmsg("FATAL: batch_isoreduce kept %u of %u classes\n", b->work->n, b->B->n);
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+static void
+bench_lphead(bench_t * b, ulong ops) {
+	Lpsink sink;
+
+	lp_text_sink(&sink, b->null);
+	while (ops--) {
+		lp_text_begin(b->K_p, b->null);
+		lp_head_rows(b->K_p, b->k, b->M, 1, &sink);
+	}
+}
+
+static void
+bench_lpgraph(bench_t * b, ulong ops) {
+	Lpsink sink;
+
+	lp_text_sink(&sink, b->null);
+	while (ops--) {
+		lp_graph_rows(next_graph(b), b->K, b->K_p, b->M, &sink);
+		lp_text_end(b->K_p, b->null);
+	}
+}
+
+static const struct {
+	const char *name;
+	bench_fn fn;
+} benches[] = {
+	{"complete_graph", bench_complete_graph},
+	{"complement", bench_complement},
+	{"covering_design", bench_covering_design},
+	{"set_s6", bench_set_s6},
+	{"str2graph", bench_str2graph},
+	{"read_graph", bench_read_graph},
+	{"isoreduce", bench_isoreduce},
+	{"batch_isoreduce", bench_batch_isoreduce},
+	{"lphead", bench_lphead},
+	{"lpgraph", bench_lpgraph}
+};
+
+/* Copy of graph i of B with vertex v as v + 1 mod n */
+static void
+relabel(bench_t * b, uint i) {
+	uint *edges, j, l, t;
+	vertex edge[UINT8_MAX];
+
+	edges = batch_add(b->twice);
+	for (j = 0; j < b->m; j++) {
+		memcpy(edge, edge_unrank(b->K, BATCH_EDGES(b->B, i)[j]), b->r);
+		for (l = 0; l < b->r; l++)
+			edge[l] = (edge[l] + 1) % b->n;
+		/* only the last vertex can have wrapped to 0 */
+		for (l = b->r - 1; l > 0 && edge[l] < edge[l - 1]; l--) {
+			t = edge[l];
+			edge[l] = edge[l - 1];
+			edge[l - 1] = t;
+		}
+		edges[j] = edge_rank(b->K, edge);
+	}
+	for (j = 1; j < b->m; j++)
+		for (l = j; l > 0 && edges[l] < edges[l - 1]; l--) {
+			t = edges[l];
+			edges[l] = edges[l - 1];
+			edges[l - 1] = t;
+		}
+}
+
+static void
+bench_init(bench_t * b, uint r, uint k, uint n) {
+	uint i;
+
+	memset(b, 0, sizeof(bench_t));
+	b->r = r;
+	b->k = k;
+	b->n = n;
+	b->K = complete_graph(n, r);
+	b->K_p = complete_graph(n + 1, r);
+	b->Kd = complete_graph(n, n - r);
+	b->m = options->m ? options->m : DEF_M;
+	if (b->m > b->K->m / 2)
+		b->m = b->K->m / 2;
+	/* the new vertex gets half of its edges */
+	b->M = b->m + (b->K_p->m - b->K->m) / 2;
+
+	b->B = subgraphs_on_m_edges(b->K, b->m);
+	b->twice = batch_alloc(b->m, 2 * b->B->n);
+	for (i = 0; i < b->B->n; i++) {
+		memcpy(batch_add(b->twice), BATCH_EDGES(b->B, i), b->m * sizeof(uint));
+		relabel(b, i);
+	}
+	b->work = batch_alloc(b->m, b->twice->n);
+
+	b->views = g_malloc(b->B->n * sizeof(Graph));
+	for (i = 0; i < b->B->n; i++)
+		batch_graph(b->B, i, b->views + i);
+
+	if (!(b->text = tmpfile())) {
+		errmsg("FATAL: tmpfile: %s\n", strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	writebatch_ei(b->B, b->text);
+	rewind(b->text);
+	b->lines = g_malloc(b->B->n * sizeof(char *));
+	for (i = 0; i < b->B->n; i++)
+		b->lines[i] = read_line(b->text);
+	rewind(b->text);
+
+	b->null = f_open("/dev/null", "w");
+}
+
+static void
+bench_free(bench_t * b) {
+	uint i;
+
+	for (i = 0; i < b->B->n; i++)
+		free(b->lines[i]);
+	free(b->lines);
+	free(b->views);
+	free_batch(b->B);
+	free_batch(b->twice);
+	free_batch(b->work);
+	free_K(b->K);
+	free_K(b->K_p);
+	free_K(b->Kd);
+	fclose(b->text);
+	f_close(b->null);
+}
+
+static ulong
+elapsed(struct timespec *t0, struct timespec *t1) {
+	return (t1->tv_sec - t0->tv_sec) * 1000000000UL + t1->tv_nsec - t0->tv_nsec;
+}
+
+static void
+run(bench_t * b, uint i, FILE * fp, int first) {
+	struct timespec t0, t1;
+	ulong ops, ns, allocs;
+
+	if (!options->quiet && fp != stdout)
+		infomsg("%s r=%u k=%u n=%u m=%u\n", benches[i].name, b->r, b->k, b->n, b->m);
+	for (ops = 1;; ops *= 2) {
+		b->next = 0;
+		allocs = g_allocs;
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		benches[i].fn(b, ops);
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		if ((ns = elapsed(&t0, &t1)) >= MIN_NS)
+			break;
+	}
+	allocs = g_allocs - allocs;
+
+	fprintf(fp, "%s\n    {\"name\": \"%s\", \"r\": %u, \"k\": %u, \"n\": %u, \"m\": %u, \"graphs\": %u, "
+		"\"ops\": %lu, \"ns_per_op\": %.1f, \"allocs_per_op\": %.2f}", first ? "" : ",",
+		benches[i].name, b->r, b->k, b->n, b->m, b->B->n, ops, (double)ns / ops, (double)allocs / ops);
+}
+
+int
+main(int argc, char *argv[]) {
+	bench_t b;
+	FILE *fp;
+	char host[256], date[32];
+	time_t now;
+	uint i, p, npoints, r, k, n;
+
+	init(argc, argv, "qvr:k:n:m:o:t:");
+
+	r = options->forbidden.r;
+	k = options->forbidden.k;
+	n = options->n;
+	if (options->help || ((r || k || n) && !(r && k && n)))
+		usage(argv[0]);
+	if (r && (n <= r || k > n + 1 || k < r)) {
+		errmsg("FATAL: need r < n and r <= k <= n + 1\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (options->use_default_outfile || !strcmp(options->outfile, "-"))
+		fp = stdout;
+	else
+		fp = open_outfile("");
+	if (gethostname(host, sizeof(host)))
+		strcpy(host, "unknown");
+	now = time(NULL);
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+	fprintf(fp, "{\n  \"host\": \"%s\",\n  \"date\": \"%s\",\n  \"threads\": %u,\n  \"results\": [", host, date,
+		nthreads());
+
+	npoints = r ? 1 : sizeof(grid) / sizeof(grid[0]);
+	for (p = 0; p < npoints; p++) {
+		bench_init(&b, r ? r : grid[p][0], r ? k : grid[p][1], r ? n : grid[p][2]);
+		for (i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+			run(&b, i, fp, !p && !i);
+		bench_free(&b);
+	}
+
+	fprintf(fp, "\n  ]\n}\n");
+	if (fp != stdout)
+		f_close(fp);
+
+	return EXIT_SUCCESS;
+}
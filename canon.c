@@ -0,0 +1,390 @@
+/*
+ * Copyright © 2011,2012,2013 Lars Lindqvist <lars.lindqvist at yandex.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Canonical labelling of r-graphs.
+
+   The graph is handled as its incidence structure, vertices-proper
+   in one colour class and edges-proper in the other.  Since no two
+   edges-proper have the same neighbourhood, every colour preserving
+   automorphism of the incidence structure is induced by a permutation
+   of the vertices-proper, so only those are ever individualized, and
+   the edges-proper are only used to refine the vertex partition.
+
+   The search is the usual individualization-refinement tree.  Leaves
+   are compared by their certificate, which is the edge set of the
+   relabelled graph as a bitset over the edges of K.  The smallest
+   certificate is the canonical one.  Leaves with equal certificates
+   give automorphisms, which are used to prune the children of every
+   node by the orbits of the automorphisms fixing the path to it.
+ */
+
+#include "graph.h"
+#include "util.h"
+#include "canon.h"
+
+#define MAXV (UINT8_MAX + 1)
+
+typedef struct {
+	Complete_graph *K;
+	uint n, m, r;
+	vertex *E;		/* edges of g as vertex tuples */
+	uint *inc_off;		/* vertex v is in edges inc[inc_off[v]] ... */
+	uint *inc;
+	ulong *ekey;		/* refinement scratch */
+	ulong *vkey;
+	ulong *cert;
+	ulong *first_cert;
+	ulong *best_cert;
+	vertex *first_inv;	/* position -> vertex at first leaf */
+	vertex *best_inv;	/* position -> vertex at best leaf */
+	vertex *best_lab;	/* vertex -> position at best leaf */
+	int have_first;
+	vertex *gens;		/* automorphisms found, n vertices each */
+	uint ngens;
+	uint maxgens;
+} Canon;
+
+int
+cert_cmp(const ulong * a, const ulong * b, Complete_graph * K) {
+	size_t i;
+
+	for (i = 0; i < K->words; i++)
+		if (a[i] != b[i])
+			return a[i] < b[i] ? -1 : 1;
+	return 0;
+}
+
+/* Number of cells in partition, cellof[v] is the position in lab
+   of the first vertex in the cell of v */
+static uint
+count_cells(Canon * C, vertex * lab, vertex * cellof) {
+	uint i, cells = 0;
+
+	for (i = 0; i < C->n; i++)
+		if (cellof[lab[i]] == i)
+			cells++;
+	return cells;
+}
+
+/* Refine partition until equitable with respect to the multiset
+   of cells met by the edges through each vertex.  Cells are split
+   in order of a key depending only on the current cells, so the
+   result does not depend on the labelling of the graph. */
+static uint
+refine(Canon * C, vertex * lab, vertex * cellof) {
+	uint cells, newcells, e, v, i, j, s, t;
+	vertex *edge, x;
+	ulong h, key;
+
+	cells = count_cells(C, lab, cellof);
+
+	while (cells < C->n) {
+		for (edge = C->E, e = 0; e < C->m; e++, edge += C->r) {
+			for (h = 0, j = 0; j < C->r; j++)
+				h += mix64(cellof[edge[j]] + 1);
+			C->ekey[e] = mix64(h);
+		}
+		for (v = 0; v < C->n; v++) {
+			for (key = 0, j = C->inc_off[v]; j < C->inc_off[v + 1]; j++)
+				key += C->ekey[C->inc[j]];
+			C->vkey[v] = key;
+		}
+
+		for (s = 0; s < C->n; s = t) {
+			for (t = s + 1; t < C->n && cellof[lab[t]] == s; t++) ;
+			if (t - s == 1)
+				continue;
+
+			/* insertion sort of cell by key */
+			for (i = s + 1; i < t; i++) {
+				x = lab[i];
+				for (j = i; j > s && C->vkey[lab[j - 1]] > C->vkey[x]; j--)
+					lab[j] = lab[j - 1];
+				lab[j] = x;
+			}
+			for (i = s + 1; i < t; i++)
+				if (C->vkey[lab[i]] != C->vkey[lab[i - 1]])
+					for (j = i; j < t && C->vkey[lab[j]] == C->vkey[lab[i]]; j++)
+						cellof[lab[j]] = i;
+		}
+
+		newcells = count_cells(C, lab, cellof);
+		if (newcells == cells)
+			break;
+		cells = newcells;
+	}
+	return cells;
+}
+
+static void
+add_generator(Canon * C, vertex * inv, vertex * cellof) {
+	vertex *gamma;
+	uint v, moved = 0;
+
+	if (C->ngens == C->maxgens) {
+		C->maxgens = C->maxgens ? 2 * C->maxgens : 8;
+		C->gens = g_realloc(C->gens, C->maxgens * C->n * sizeof(vertex));
+	}
+	gamma = C->gens + C->ngens * C->n;
+	for (v = 0; v < C->n; v++) {
+		gamma[v] = inv[cellof[v]];
+		moved += gamma[v] != v;
+	}
+	if (moved)
+		C->ngens++;
+}
+
+static void
+leaf(Canon * C, vertex * lab, vertex * cellof) {
+	vertex edge[MAXV], x, *e;
+	uint i, j, k;
+	int cmp;
+
+	memset(C->cert, 0, C->K->words * sizeof(ulong));
+	for (e = C->E, i = 0; i < C->m; i++, e += C->r) {
+		for (j = 0; j < C->r; j++) {
+			x = cellof[e[j]];
+			for (k = j; k > 0 && edge[k - 1] > x; k--)
+				edge[k] = edge[k - 1];
+			edge[k] = x;
+		}
+		BIT_SET(C->cert, edge_rank(C->K, edge));
+	}
+
+	if (!C->have_first) {
+		C->have_first = 1;
+		memcpy(C->first_cert, C->cert, C->K->words * sizeof(ulong));
+		memcpy(C->best_cert, C->cert, C->K->words * sizeof(ulong));
+		memcpy(C->first_inv, lab, C->n);
+		memcpy(C->best_inv, lab, C->n);
+		memcpy(C->best_lab, cellof, C->n);
+		return;
+	}
+
+	if (!cert_cmp(C->cert, C->first_cert, C->K)) {
+		add_generator(C, C->first_inv, cellof);
+		return;
+	}
+
+	cmp = cert_cmp(C->cert, C->best_cert, C->K);
+	if (!cmp) {
+		add_generator(C, C->best_inv, cellof);
+	} else if (cmp < 0) {
+		memcpy(C->best_cert, C->cert, C->K->words * sizeof(ulong));
+		memcpy(C->best_inv, lab, C->n);
+		memcpy(C->best_lab, cellof, C->n);
+	}
+}
+
+static uint
+uf_find(uint * uf, uint v) {
+	while (uf[v] != v)
+		v = uf[v] = uf[uf[v]];
+	return v;
+}
+
+/* Orbits of the automorphisms found so far that fix path pointwise */
+static void
+path_orbits(Canon * C, vertex * path, uint depth, uint * uf) {
+	vertex *gamma;
+	uint i, v, a, b;
+
+	for (v = 0; v < C->n; v++)
+		uf[v] = v;
+
+	for (gamma = C->gens, i = 0; i < C->ngens; i++, gamma += C->n) {
+		for (v = 0; v < depth; v++)
+			if (gamma[path[v]] != path[v])
+				break;
+		if (v < depth)
+			continue;
+		for (v = 0; v < C->n; v++) {
+			a = uf_find(uf, v);
+			b = uf_find(uf, gamma[v]);
+			if (a != b)
+				uf[a > b ? a : b] = a > b ? b : a;
+		}
+	}
+}
+
+static void
+search(Canon * C, vertex * lab, vertex * cellof, vertex * path, uint depth) {
+	vertex lab2[MAXV], cellof2[MAXV], cand[MAXV], tried[MAXV];
+	uint uf[MAXV];
+	uint s, t, i, j, ncand, ntried, w;
+
+	/* first non-singleton cell */
+	for (s = 0; s < C->n; s = t) {
+		for (t = s + 1; t < C->n && cellof[lab[t]] == s; t++) ;
+		if (t - s > 1)
+			break;
+	}
+	if (s >= C->n) {
+		leaf(C, lab, cellof);
+		return;
+	}
+
+	ncand = t - s;
+	memcpy(cand, lab + s, ncand);
+
+	for (ntried = i = 0; i < ncand; i++) {
+		w = cand[i];
+
+		path_orbits(C, path, depth, uf);
+		for (j = 0; j < ntried; j++)
+			if (uf_find(uf, w) == uf_find(uf, tried[j]))
+				break;
+		if (j < ntried)
+			continue;
+
+		/* individualize w */
+		memcpy(lab2, lab, C->n);
+		memcpy(cellof2, cellof, C->n);
+		for (j = s; lab2[j] != w; j++) ;
+		lab2[j] = lab2[s];
+		lab2[s] = w;
+		for (j = s + 1; j < t; j++)
+			cellof2[lab2[j]] = s + 1;
+
+		refine(C, lab2, cellof2);
+
+		path[depth] = w;
+		search(C, lab2, cellof2, path, depth + 1);
+		tried[ntried++] = w;
+	}
+}
+
+/* Return canonical certificate of g, the edge set of g relabelled
+   canonically, as a bitset of K->words ulongs to be freed by the
+   caller.  Two graphs are isomorphic if and only if their
+   certificates are equal.  If lab is not NULL, the canonical label
+   of each vertex v is stored in lab[v].  If gens is not NULL, it is
+   set to a malloc'd array of *ngens automorphisms, K->n vertices each,
+   that generate the automorphism group of g. */
+ulong *
+canon_aut(Graph * g, Complete_graph * K, vertex * lab, vertex ** gens, uint * ngens) {
+	Canon C;
+	vertex lab0[MAXV], cellof0[MAXV], path[MAXV], *edge;
+	uint i, j, v;
+	ulong *ret;
+
+	C.K = K;
+	C.n = K->n;
+	C.m = g->m;
+	C.r = K->r;
+	C.have_first = 0;
+	C.gens = NULL;
+	C.ngens = C.maxgens = 0;
+
+	C.E = g_malloc((C.m * C.r + 1) * sizeof(vertex));
+	C.inc_off = g_calloc(C.n + 1, sizeof(uint));
+	C.inc = g_malloc((C.m * C.r + 1) * sizeof(uint));
+	C.ekey = g_malloc((C.m + 1) * sizeof(ulong));
+	C.vkey = g_malloc(C.n * sizeof(ulong));
+	C.cert = Balloc(K);
+	C.first_cert = Balloc(K);
+	C.best_cert = Balloc(K);
+	C.first_inv = g_malloc(C.n);
+	C.best_inv = g_malloc(C.n);
+	C.best_lab = g_malloc(C.n);
+
+	for (i = 0; i < C.m; i++) {
+		edge = edge_unrank(K, g->edges[i]);
+		memcpy(C.E + i * C.r, edge, K->edge_len);
+		for (j = 0; j < C.r; j++)
+			C.inc_off[edge[j] + 1]++;
+	}
+	for (v = 0; v < C.n; v++)
+		C.inc_off[v + 1] += C.inc_off[v];
+	for (i = 0; i < C.m; i++)
+		for (j = 0; j < C.r; j++) {
+			v = C.E[i * C.r + j];
+			C.inc[C.inc_off[v]++] = i;
+		}
+	for (v = C.n; v > 0; v--)
+		C.inc_off[v] = C.inc_off[v - 1];
+	C.inc_off[0] = 0;
+
+	for (v = 0; v < C.n; v++) {
+		lab0[v] = v;
+		cellof0[v] = 0;
+	}
+	refine(&C, lab0, cellof0);
+	search(&C, lab0, cellof0, path, 0);
+
+	if (lab)
+		memcpy(lab, C.best_lab, C.n);
+	if (gens) {
+		*gens = C.gens;
+		*ngens = C.ngens;
+		C.gens = NULL;
+	}
+	ret = C.best_cert;
+
+	free(C.E);
+	free(C.inc_off);
+	free(C.inc);
+	free(C.ekey);
+	free(C.vkey);
+	free(C.cert);
+	free(C.first_cert);
+	free(C.first_inv);
+	free(C.best_inv);
+	free(C.best_lab);
+	free(C.gens);
+
+	return ret;
+}
+
+ulong *
+canon_cert(Graph * g, Complete_graph * K, vertex * lab) {
+	return canon_aut(g, K, lab, NULL, NULL);
+}
+
+/* Orbits of the group generated by gens on the edges of K,
+   orbit[e] is the smallest edge index in the orbit of e */
+void
+edge_orbits(vertex * gens, uint ngens, Complete_graph * K, uint * orbit) {
+	vertex edge[MAXV], x, *e, *gamma;
+	uint i, j, l, a, b, f;
+
+	for (i = 0; i < K->m; i++)
+		orbit[i] = i;
+
+	for (gamma = gens, l = 0; l < ngens; l++, gamma += K->n) {
+		for (e = K->edges, i = 0; i < K->m; i++, e += K->r) {
+			for (j = 0; j < K->r; j++) {
+				x = gamma[e[j]];
+				for (f = j; f > 0 && edge[f - 1] > x; f--)
+					edge[f] = edge[f - 1];
+				edge[f] = x;
+			}
+			a = uf_find(orbit, i);
+			b = uf_find(orbit, edge_rank(K, edge));
+			if (a != b)
+				orbit[a > b ? a : b] = a > b ? b : a;
+		}
+	}
+
+	for (i = 0; i < K->m; i++)
+		orbit[i] = uf_find(orbit, i);
+}
@@ -0,0 +1,208 @@
+/*
+ * Copyright © 2011,2012,2013 Lars Lindqvist <lars.lindqvist at yandex.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* The catalogue of results, the file `catalog' in the graph
+   directory.  Every level, the graphs on n vertices and m edges,
+   that a run has finished is a line
+
+	r k lambda n m status graphs bytes checksum time host program
+
+   where the status is complete, with the graphs in the file
+   graphs-r=#-k=#-n=#-m=#.ei, graphs-double-r=#-... for lambda 2, of
+   bytes bytes and FNV-1a checksum
+   checksum, or empty, if there are no such graphs.  Lines are only
+   appended, each by a single write(), so that runs can share the
+   catalogue, and the last line of a level is the one that counts.
+
+   The dontexist-N-M markers of the scripts leave out r, k and lambda,
+   so when the catalogue has a level it is what decides whether the
+   level is done.  A graph file of a level the catalogue doesn't have
+   is taken to be complete, as it was before there was a catalogue. */
+
+#include "graph.h"
+#include "util.h"
+#include "graphfile.h"
+#include "catalog.h"
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+
+static const char *status_names[] = { "unknown", "complete", "empty" };
+
+static Catentry *entries;
+static uint n_entries, size_entries;
+static off_t loaded;		/* bytes of the catalogue in entries */
+
+static char *
+catalog_path() {
+	static char path[PATH_MAX];
+
+	snprintf(path, PATH_MAX, "%s/catalog", options->graph_dir);
+	return path;
+}
+
+const char *
+catalog_status(int status) {
+	return status_names[status];
+}
+
+/* Read the lines appended since the last time */
+static void
+catalog_load() {
+	FILE *fp;
+	struct stat st;
+	char line[1024], status[16];
+	Catentry e;
+	int i;
+
+	if (!(fp = fopen(catalog_path(), "r")))
+		return;
+	if (fstat(fileno(fp), &st) || st.st_size < loaded)
+		loaded = n_entries = 0;
+	if (fseeko(fp, loaded, SEEK_SET)) {
+		errmsg("ERROR: fseeko: %s: %s\n", catalog_path(), strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	/* a line without its newline is still being written */
+	while (fgets(line, sizeof(line), fp) && strchr(line, '\n')) {
+		loaded += strlen(line);
+		if (line[0] == '#')
+			continue;
+		if (sscanf(line, "%u %u %u %u %u %15s %lu %lu %lx %255[^\n]",
+			   &e.r, &e.k, &e.lambda, &e.n, &e.m, status,
+			   &e.graphs, &e.bytes, &e.checksum, e.provenance) != 10) {
+			errmsg("WARNING: %s: bad line: %s", catalog_path(), line);
+			continue;
+		}
+		for (i = CAT_EMPTY; i > CAT_UNKNOWN && strcmp(status, status_names[i]); i--) ;
+		e.status = i;
+
+		if (n_entries == size_entries) {
+			size_entries = size_entries ? 2 * size_entries : 64;
+			entries = g_realloc(entries, size_entries * sizeof(Catentry));
+		}
+		entries[n_entries++] = e;
+	}
+	fclose(fp);
+}
+
+/* Last entry of the level */
+static Catentry *
+find(uint r, uint k, uint lambda, uint n, uint m) {
+	uint i;
+
+	for (i = n_entries; i-- > 0;)
+		if (entries[i].r == r && entries[i].k == k && entries[i].n == n && entries[i].m == m
+		    && entries[i].lambda == lambda)
+			return entries + i;
+	return NULL;
+}
+
+/* Status of the level, and its entry to e if there is one */
+int
+catalog_lookup(uint r, uint k, uint lambda, uint n, uint m, Catentry * e) {
+	Catentry *found;
+
+	catalog_load();
+	if (!(found = find(r, k, lambda, n, m)))
+		return CAT_UNKNOWN;
+	if (e)
+		*e = *found;
+	return found->status;
+}
+
+/* Whether the level is done: CAT_COMPLETE if its graphs are in path,
+   as catalogued, CAT_EMPTY if there are none, otherwise CAT_UNKNOWN */
+int
+catalog_done(uint r, uint k, uint lambda, uint n, uint m, const char *path) {
+	struct stat st;
+	Catentry e;
+
+	if (catalog_lookup(r, k, lambda, n, m, &e) == CAT_UNKNOWN)
+		return !stat(path, &st) && st.st_size ? CAT_COMPLETE : CAT_UNKNOWN;
+	if (e.status == CAT_COMPLETE && (stat(path, &st) || (ulong)st.st_size != e.bytes)) {
+		errmsg("WARNING: %s is not the file catalogued for N=%u M=%u\n", path, n, m);
+		return CAT_UNKNOWN;
+	}
+	return e.status;
+}
+
+ulong
+catalog_checksum(const char *path) {
+	FILE *fp;
+	ulong h = 14695981039346656037UL;
+	int c;
+
+	if (!(fp = fopen(path, "r")))
+		return 0;
+	while ((c = getc(fp)) != EOF)
+		h = (h ^ (unsigned char)c) * 1099511628211UL;
+	fclose(fp);
+
+	return h;
+}
+
+/* Catalogue the level as complete with its graphs in path, or as
+   empty if path is NULL or there are no graphs in it */
+void
+catalog_record(uint r, uint k, uint lambda, uint n, uint m, const char *path, const char *program) {
+	struct stat st;
+	char line[1024], host[64], date[32];
+	ulong graphs = 0, bytes = 0, checksum = 0;
+	time_t now = time(NULL);
+	int fd, len;
+
+	if (path && !stat(path, &st) && st.st_size && (graphs = graphfile_count(path))) {
+		bytes = st.st_size;
+		checksum = catalog_checksum(path);
+	}
+	if (gethostname(host, sizeof(host)))
+		strcpy(host, "unknown");
+	host[sizeof(host) - 1] = '\0';
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+	len = snprintf(line, sizeof(line), "%u %u %u %u %u %s %lu %lu %016lx %s %s %s\n",
+		       r, k, lambda, n, m, status_names[graphs ? CAT_COMPLETE : CAT_EMPTY],
+		       graphs, bytes, checksum, date, host, program);
+
+	fd = open(catalog_path(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+	if (fd < 0 || write(fd, line, len) != len || close(fd)) {
+		errmsg("FATAL: %s: %s\n", catalog_path(), strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+}
+
+/* The levels of r, k and lambda, as they stand */
+void
+catalog_print(FILE * fp, uint r, uint k, uint lambda) {
+	Catentry *e;
+	uint i;
+
+	catalog_load();
+	for (i = 0; i < n_entries; i++) {
+		e = entries + i;
+		if (e->r != r || e->k != k || e->lambda != lambda || find(r, k, lambda, e->n, e->m) != e)
+			continue;
+		fprintf(fp, "n=%u m=%u %s %lu %s\n", e->n, e->m, status_names[e->status], e->graphs, e->provenance);
+	}
+}
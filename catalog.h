@@ -0,0 +1,46 @@
+/*
+ * Copyright © 2011,2012,2013 Lars Lindqvist <lars.lindqvist at yandex.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include "graph.h"
+
+enum { CAT_UNKNOWN, CAT_COMPLETE, CAT_EMPTY };
+
+typedef struct {
+	uint r, k, lambda, n, m;
+	int status;
+	ulong graphs;
+	ulong bytes;		/* of the graph file */
+	ulong checksum;		/* of the graph file */
+	char provenance[256];	/* time, host and program */
+} Catentry;
+
+int catalog_lookup(uint, uint, uint, uint, uint, Catentry*);
+int catalog_done(uint, uint, uint, uint, uint, const char*);
+void catalog_record(uint, uint, uint, uint, uint, const char*, const char*);
+void catalog_print(FILE*, uint, uint, uint);
+ulong catalog_checksum(const char*);
+const char *catalog_status(int);
+
+#endif
@@ -0,0 +1,329 @@
+/*
+ * Copyright © 2011,2012,2013 Lars Lindqvist <lars.lindqvist at yandex.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Set of keys, each stored together with one representative graph
+   on m edges.  Keys are canonical certificates of K->words ulongs,
+   or any other fixed number of ulongs, such as invariant hashes or
+   labelled edge sets.
+
+   A record is the key, one ulong of flags, such as CERTSET_WRITTEN
+   if the representative has already been written, and the m edge
+   indices of the representative packed two per ulong.  Records are
+   kept in one growing array and found through an open addressing
+   hash table of record numbers.
+
+   When the set grows too large it can be spilled to a run file,
+   records sorted by key, and emptied.  certset_merge() then makes
+   one pass over all runs of certificates and writes the
+   representatives of the classes that were not already written.
+ */
+
+#include "graph.h"
+#include "util.h"
+#include "canon.h"
+#include "certset.h"
+
+struct Certset {
+	size_t words;		/* ulongs per key */
+	uint m;
+	size_t rec_words;
+	ulong *recs;
+	uint nrecs;
+	uint maxrecs;
+	uint *table;		/* record number + 1, 0 if empty */
+	uint tablesize;		/* power of two */
+};
+
+#define REC(S, i) ((S)->recs + (size_t)(i) * (S)->rec_words)
+#define REC_FLAG(S, rec) ((rec)[(S)->words])
+#define REC_EDGES(S, rec) ((uint *)((rec) + (S)->words + 1))
+
+static ulong
+hash_key(ulong * key, size_t words) {
+	ulong h = 0xcbf29ce484222325ULL;
+	size_t i;
+
+	for (i = 0; i < words; i++) {
+		h ^= key[i];
+		h *= 0x100000001b3ULL;
+		h ^= h >> 29;
+	}
+	return h;
+}
+
+static int
+key_cmp(const ulong * a, const ulong * b, size_t words) {
+	size_t i;
+
+	for (i = 0; i < words; i++)
+		if (a[i] != b[i])
+			return a[i] < b[i] ? -1 : 1;
+	return 0;
+}
+
+Certset *
+certset_new(size_t words, uint m) {
+	Certset *S;
+
+	S = g_malloc(sizeof(Certset));
+	S->words = words;
+	S->m = m;
+	S->rec_words = words + 1 + (m + 1) / 2;
+	S->nrecs = 0;
+	S->maxrecs = 64;
+	S->recs = g_malloc(S->maxrecs * S->rec_words * sizeof(ulong));
+	S->tablesize = 128;
+	S->table = g_calloc(S->tablesize, sizeof(uint));
+
+	return S;
+}
+
+void
+certset_free(Certset * S) {
+	free(S->recs);
+	free(S->table);
+	free(S);
+}
+
+void
+certset_clear(Certset * S) {
+	S->nrecs = 0;
+	memset(S->table, 0, S->tablesize * sizeof(uint));
+}
+
+static void
+grow_table(Certset * S) {
+	uint i, j;
+
+	free(S->table);
+	S->tablesize *= 2;
+	S->table = g_calloc(S->tablesize, sizeof(uint));
+	for (i = 0; i < S->nrecs; i++) {
+		j = hash_key(REC(S, i), S->words) & (S->tablesize - 1);
+		while (S->table[j])
+			j = (j + 1) & (S->tablesize - 1);
+		S->table[j] = i + 1;
+	}
+}
+
+/* Table slot of key, either holding it or empty */
+static uint
+slot(Certset * S, ulong * key) {
+	uint j;
+
+	j = hash_key(key, S->words) & (S->tablesize - 1);
+	while (S->table[j] && key_cmp(REC(S, S->table[j] - 1), key, S->words))
+		j = (j + 1) & (S->tablesize - 1);
+	return j;
+}
+
+/* Record number of key, or -1 if not in set */
+int
+certset_find(Certset * S, ulong * key) {
+	return (int)S->table[slot(S, key)] - 1;
+}
+
+/* Add key with representative g, which may be NULL if m is 0.
+   Return 1 if key was not already in the set, the new record
+   is then number certset_count(S) - 1. */
+int
+certset_add(Certset * S, ulong * key, Graph * g, ulong flag) {
+	ulong *rec;
+	uint j;
+
+	j = slot(S, key);
+	if (S->table[j])
+		return 0;
+
+	if (S->nrecs == S->maxrecs) {
+		S->maxrecs *= 2;
+		S->recs = g_realloc(S->recs, S->maxrecs * S->rec_words * sizeof(ulong));
+	}
+	rec = REC(S, S->nrecs);
+	memset(rec, 0, S->rec_words * sizeof(ulong));
+	memcpy(rec, key, S->words * sizeof(ulong));
+	REC_FLAG(S, rec) = flag;
+	if (S->m)
+		memcpy(REC_EDGES(S, rec), g->edges, S->m * sizeof(uint));
+
+	S->table[j] = ++S->nrecs;
+	if (2 * S->nrecs > S->tablesize)
+		grow_table(S);
+
+	return 1;
+}
+
+/* Key of record i */
+ulong *
+certset_key(Certset * S, uint i) {
+	return REC(S, i);
+}
+
+/* Flags of record i, may be changed by caller */
+ulong *
+certset_flag(Certset * S, uint i) {
+	return &REC_FLAG(S, REC(S, i));
+}
+
+/* Edges of the representative of record i */
+uint *
+certset_edges(Certset * S, uint i) {
+	return REC_EDGES(S, REC(S, i));
+}
+
+uint
+certset_count(Certset * S) {
+	return S->nrecs;
+}
+
+/* Memory used by the records in the set, counting the two or more
+   table slots per record kept by the load factor */
+size_t
+certset_bytes(Certset * S) {
+	return (size_t)S->nrecs * (S->rec_words * sizeof(ulong) + 2 * sizeof(uint));
+}
+
+/* Write the records of S to fp in the order they were added, for
+   certset_load() */
+void
+certset_save(Certset * S, FILE * fp) {
+	if (fwrite(&S->nrecs, sizeof(uint), 1, fp) != 1
+	    || fwrite(S->recs, S->rec_words * sizeof(ulong), S->nrecs, fp) != S->nrecs) {
+		errmsg("FATAL: writing set: %s\n", strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+}
+
+/* Add the records written by certset_save() to S, which must have
+   the same words and m as the set saved.  Returns 0 if fp ends first. */
+int
+certset_load(Certset * S, FILE * fp) {
+	uint n, end;
+
+	if (fread(&n, sizeof(uint), 1, fp) != 1)
+		return 0;
+	end = S->nrecs + n;
+	if (end > S->maxrecs) {
+		while (end > S->maxrecs)
+			S->maxrecs *= 2;
+		S->recs = g_realloc(S->recs, S->maxrecs * S->rec_words * sizeof(ulong));
+	}
+	if (fread(REC(S, S->nrecs), S->rec_words * sizeof(ulong), n, fp) != n)
+		return 0;
+
+	while (S->nrecs < end) {
+		S->table[slot(S, REC(S, S->nrecs))] = S->nrecs + 1;
+		if (2 * ++S->nrecs > S->tablesize)
+			grow_table(S);
+	}
+	return 1;
+}
+
+static Certset *sort_S;		/* for cmp_rec(), qsort has no context */
+
+static int
+cmp_rec(const void *a, const void *b) {
+	return key_cmp(REC(sort_S, *(const uint *)a), REC(sort_S, *(const uint *)b), sort_S->words);
+}
+
+/* Write records to fp sorted by key, and empty the set */
+void
+certset_spill(Certset * S, FILE * fp) {
+	uint *order, i;
+
+	order = g_malloc((S->nrecs + 1) * sizeof(uint));
+	for (i = 0; i < S->nrecs; i++)
+		order[i] = i;
+	sort_S = S;
+	qsort(order, S->nrecs, sizeof(uint), cmp_rec);
+
+	for (i = 0; i < S->nrecs; i++) {
+		if (fwrite(REC(S, order[i]), sizeof(ulong), S->rec_words, fp) != S->rec_words) {
+			errmsg("FATAL: writing spill file: %s\n", strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+	}
+	free(order);
+
+	certset_clear(S);
+}
+
+/* Merge sorted runs, write the first representative of every class
+   that has no written record in any run.  Runs are rewound first,
+   and earlier runs take precedence.  Returns number of graphs written. */
+uint
+certset_merge(FILE ** runs, uint nruns, Complete_graph * K, uint m, Graphfile * out) {
+	Certset *S;
+	ulong *head, *rec;
+	unsigned char *live;
+	uint i, min, written = 0;
+	int seen;
+	Graph *g;
+
+	S = certset_new(K->words, m);
+	head = g_malloc((nruns + 1) * S->rec_words * sizeof(ulong));
+	live = g_calloc(nruns + 1, sizeof(unsigned char));
+	g = Galloc(K->n, m);
+
+#define HEAD(i) (head + (size_t)(i) * S->rec_words)
+#define ADVANCE(i) (live[i] = fread(HEAD(i), sizeof(ulong), S->rec_words, runs[i]) == S->rec_words)
+
+	for (i = 0; i < nruns; i++) {
+		rewind(runs[i]);
+		ADVANCE(i);
+	}
+
+	for (;;) {
+		for (min = nruns, i = 0; i < nruns; i++)
+			if (live[i] && (min == nruns || cert_cmp(HEAD(i), HEAD(min), K) < 0))
+				min = i;
+		if (min == nruns)
+			break;
+
+		/* min is the earliest run holding the smallest certificate */
+		rec = HEAD(min);
+		seen = 0;
+		for (i = nruns; i-- > min;) {
+			if (!live[i] || cert_cmp(HEAD(i), rec, K))
+				continue;
+			seen |= (REC_FLAG(S, HEAD(i)) & CERTSET_WRITTEN) != 0;
+			if (i != min)
+				ADVANCE(i);
+		}
+		if (!seen) {
+			memcpy(g->edges, REC_EDGES(S, rec), m * sizeof(uint));
+			graphfile_write(out, g, K);
+			written++;
+		}
+		ADVANCE(min);
+	}
+
+#undef ADVANCE
+#undef HEAD
+
+	free_G(g);
+	free(live);
+	free(head);
+	certset_free(S);
+
+	return written;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright © 2011,2012,2013 Lars Lindqvist <lars.lindqvist at yandex.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CERTSET_H
+#define CERTSET_H
+
+#include "graph.h"
+#include "graphfile.h"
+
+typedef struct Certset Certset;
+
+#define CERTSET_WRITTEN (1 << 0)
+
+Certset *certset_new(size_t, uint);
+int certset_add(Certset*, ulong*, Graph*, ulong);
+int certset_find(Certset*, ulong*);
+ulong *certset_key(Certset*, uint);
+ulong *certset_flag(Certset*, uint);
+uint *certset_edges(Certset*, uint);
+size_t certset_bytes(Certset*);
+uint certset_count(Certset*);
+void certset_spill(Certset*, FILE*);
+void certset_clear(Certset*);
+void certset_free(Certset*);
+void certset_save(Certset*, FILE*);
+int certset_load(Certset*, FILE*);
+uint certset_merge(FILE**, uint, Complete_graph*, uint, Graphfile*);
+
+#endif
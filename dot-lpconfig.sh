@@ -1,10 +1,16 @@
 #!/bin/sh
 LPTHREADS=1
+LPJOBS=1
 LPMINSOLN=0
 LPWRTBACK=0
 LPTIMEOUT=20
 LPMAXSOLN=1000
 LPSTOP=no
+LPDIRECT=yes
+LPSOLVER=gurobi
+LPENUM=no
+LPSYMMETRY=yes
+LPCUBES=0
 
 
 case `hostname` in
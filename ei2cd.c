@@ -21,6 +21,9 @@
  */
 
 #include "util.h"
+#include "graphfile.h"
+
+#define BATCH 4096
 
 static void
 usage(const char *prog) {
@@ -48,24 +51,28 @@ usage(const char *prog) {
 		"	      Default output filename is `covdes-n=#-k=#-t=#.txt'\n"
 		"	      where n := n, k := n - r, t := n - k\n"
 		"	      -r, -k, -n and -m may be omitted if input filename\n"
-		"	      contains `-r=#', `-k=#', `-n=#' and `-m=#'\n", prog);
+		"	      contains `-r=#', `-k=#', `-n=#' and `-m=#',\n"
+		"	      or if the input is a binary graph file\n", prog);
 
 	exit(EXIT_FAILURE);
 }
 
 int
 main(int argc, char *argv[]) {
-	FILE *in_fp, *out_fp;
+	Graphfile *in;
+	FILE *out_fp;
 	uint n = 0, r = 0, k = 0, m = 0, dummy;
 	Complete_graph *K, *K_d;
-	Graph *tmp, *cd;
+	GraphBatch *B, *cd;
 	int error = 0;
 
 	init(argc, argv, "r:k:n:m:ao:f:D:Cv");
 
 	if (options->help)
 		usage(argv[0]);
-	if ((!(r = options->forbidden.r)
+	in = graphfile_open_in();
+	if (!graphfile_params(in, &r, &k, &n, &m)
+	    && (!(r = options->forbidden.r)
 	     || !(k = options->forbidden.k)
 	     || !(n = options->n)
 	     || !(m = options->m))
@@ -83,23 +90,20 @@ main(int argc, char *argv[]) {
 	K = complete_graph(n, r);
 	K_d = complete_graph(K->n, K->n - K->r);
 
-	in_fp = open_infile();
-
-	while (!feof(in_fp)) {
-		tmp = read_graph(K, m, in_fp);
-		if (!tmp) {
-			error = read_line_errno;
-			break;
-		}
-		cd = covering_design(tmp, K, K_d);
+	B = batch_alloc(m, BATCH);
+	do {
+		B->n = 0;
+		graphfile_read_batch(in, K, B, BATCH);
+		cd = batch_covering_design(B, K, K_d);
 		assert(cd);
-		writeg(cd, K_d, out_fp);
-		free_G(tmp);
-		free_G(cd);
-	}
+		writebatch(cd, K_d, out_fp);
+		free_batch(cd);
+	} while (B->n == BATCH);
+	error = read_line_errno;
+	free_batch(B);
 
 	f_close(out_fp);
-	f_close(in_fp);
+	graphfile_close(in);
 	free_K(K);
 
 	return error;
@@ -21,6 +21,7 @@
  */
 
 #include "util.h"
+#include "graphfile.h"
 
 static void
 usage(const char *prog) {
@@ -47,14 +48,16 @@ usage(const char *prog) {
 		OUTDIR "\n"
 		"	      Default output filename is `graphs-r=#-k=#-n=#-m=#.txt'\n"
 		"	      -r, -k, -n and -m may be omitted if input filename\n"
-		"	      contains `-r=#-k=#-n=#-m=#'\n", prog);
+		"	      contains `-r=#-k=#-n=#-m=#',\n"
+		"	      or if the input is a binary graph file\n", prog);
 
 	exit(EXIT_FAILURE);
 }
 
 int
 main(int argc, char *argv[]) {
-	FILE *in_fp, *out_fp;
+	Graphfile *in;
+	FILE *out_fp;
 	uint n = 0, r = 0, k = 0, m = 0, dummy;
 	Complete_graph *K;
 	Graph *tmp;
@@ -64,7 +67,9 @@ main(int argc, char *argv[]) {
 
 	if (options->help)
 		usage(argv[0]);
-	if ((!(r = options->forbidden.r)
+	in = graphfile_open_in();
+	if (!graphfile_params(in, &r, &k, &n, &m)
+	    && (!(r = options->forbidden.r)
 	     || !(k = options->forbidden.k)
 	     || !(n = options->n)
 	     || !(m = options->m))
@@ -80,18 +85,14 @@ main(int argc, char *argv[]) {
 	}
 
 	K = complete_graph(n, r);
-	in_fp = open_infile();
-	while (!feof(in_fp)) {
-		tmp = read_graph(K, m, in_fp);
-		if (!tmp) {
-			error = read_line_errno;
-			break;
-		}
+	tmp = Galloc(K->n, m);
+	while (graphfile_read_into(in, K, tmp)) {
 		writeg(tmp, K, out_fp);
-		free_G(tmp);
 	}
+	error = read_line_errno;
+	free_G(tmp);
 	f_close(out_fp);
-	f_close(in_fp);
+	graphfile_close(in);
 	free_K(K);
 
 	return error;
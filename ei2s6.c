@@ -21,6 +21,9 @@
  */
 
 #include "util.h"
+#include "graphfile.h"
+
+#define BATCH 4096
 
 static void
 usage(const char *prog) {
@@ -46,24 +49,28 @@ usage(const char *prog) {
 		"	      3) compile time definition OUTDIR=" OUTDIR "\n"
 		"	      Default output filename is `graphs-r=#-k=#-n=#-m=#.s6'\n"
 		"	      -r, -k, -n and -m may be omitted if input filename\n"
-		"	      contains `-r=#-k=#-n=#-m=#'\n", prog);
+		"	      contains `-r=#-k=#-n=#-m=#',\n"
+		"	      or if the input is a binary graph file\n", prog);
 
 	exit(EXIT_FAILURE);
 }
 
 int
 main(int argc, char *argv[]) {
-	FILE *in_fp, *out_fp;
+	Graphfile *in;
+	FILE *out_fp;
 	uint n = 0, r = 0, k = 0, m = 0, dummy;
 	Complete_graph *K;
-	Graph *comp;
+	GraphBatch *B, *comp;
 	int error = 0;
 
 	init(argc, argv, "r:k:n:m:ao:f:D:Cqv");
 
 	if (options->help)
 		usage(argv[0]);
-	if ((!(r = options->forbidden.r)
+	in = graphfile_open_in();
+	if (!graphfile_params(in, &r, &k, &n, &m)
+	    && (!(r = options->forbidden.r)
 	     || !(k = options->forbidden.k)
 	     || !(n = options->n)
 	     || !(m = options->m))
@@ -77,24 +84,22 @@ main(int argc, char *argv[]) {
 		return 0;
 	}
 
-	in_fp = open_infile();
-
 	K = complete_graph(n, r);
 
-	while (!feof(in_fp)) {
-		comp = read_graph_to_complement(K, m, in_fp);
-		if (!comp) {
-			error = read_line_errno;
-			break;
-		}
-		set_s6(comp, K);
-		fprintf(out_fp, "%s\n", comp->s6);
-		free(comp->s6);
-		free_G(comp);
-	}
+	B = batch_alloc(m, BATCH);
+	do {
+		B->n = 0;
+		graphfile_read_batch(in, K, B, BATCH);
+		comp = batch_complement(B, K);
+		batch_set_s6(comp, K);
+		writebatch_s6(comp, out_fp);
+		free_batch(comp);
+	} while (B->n == BATCH);
+	error = read_line_errno;
+	free_batch(B);
 
 	f_close(out_fp);
-	f_close(in_fp);
+	graphfile_close(in);
 	free_K(K);
 
 	return error;
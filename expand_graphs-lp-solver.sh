@@ -30,6 +30,7 @@ echo -e "${COLOR_INFO}$0 $*${COLOR_RESET}"
 
 if [ -z $1 ];then
 	echo -e "${COLOR_ERROR}usage: `basename $0` <linearprog.lp>${COLOR_RESET}"
+	echo -e "${COLOR_ERROR}       `basename $0` <graphs.ei> <M> [-double]${COLOR_RESET}"
 	exit 1
 fi
 if [ ! -f $1 ];then
@@ -63,6 +64,9 @@ fi
 if [ -z $LPTHREADS ];then
 	export LPTHREADS=1
 fi
+if [ -z $LPJOBS ];then
+	export LPJOBS=1
+fi
 if [ -z $LPMINSOLN ];then
 	export LPMINSOLN=0
 fi
@@ -75,39 +79,106 @@ fi
 if [ -z $LPSIFTTIMEOUT ];then
 	export LPSIFTTIMEOUT=30
 fi
-if [ -z $LPOVERWRITEOLDSOLN ];then
-	LPMVARG="-i"
-elif [ "$LPOVERWRITEOLDSOLN" = "no" ];then
-	LPMVARG="-i"
+# gurobi, or native for extsolve which needs no licence, but has no limits
+if [ -z $LPSOLVER ];then
+	export LPSOLVER=gurobi
+fi
+if [ "$LPSYMMETRY" != "no" ];then
+	SYMMETRY="-y"
+fi
+if [ "$LPSOLVER" = "native" ];then
+	LPSOLVE="./extsolve"
+	LPLIMITS=""
+else
+	LPSOLVE="./lpsolve"
+	LPLIMITS="-T$LPTIMEOUT -t$LPTHREADS -s$LPMINSOLN -S$LPMAXSOLN -w$LPWRTBACK"
+	# all solutions in one search, needs gurobi 5.0 or later
+	if [ "$LPENUM" = "yes" ];then
+		LPLIMITS="-e $LPLIMITS"
+	fi
+	# LPs that hit a limit are split into 2^LPCUBES cubes by lpsolve
+	# itself and solved by LPJOBS workers, split.py is then a fallback
+	if [ -n "$LPCUBES" ] && [ "$LPCUBES" != "0" ];then
+		LPLIMITS="-c$LPCUBES $LPLIMITS"
+	fi
+fi
+if [ -z $LPRUNLOG ];then
+	export LPRUNLOG=$GRAPH_DIR/runlog
 fi
 
+# Fold a solution file into the graphs of its level as soon as it is
+# written, isoreduce -I keeps the classes found so far in a store, and
+# remove it.  The level is taken from the name of the file.
+store_soln() {
+	# don't keep zero byte files
+	find $1 -empty -delete
+	if [ ! -f $1 ];then
+		return
+	fi
+
+	NAME=`basename $1`
+	if [[ ! $NAME =~ ^solve(-double)?-r=([0-9]+)-k=([0-9]+)-.*-N=([0-9]+)-M=([0-9]+) ]];then
+		echo -e "${COLOR_ERROR}FATAL: no level in the name of $1${COLOR_RESET}"
+		exit 1
+	fi
+	STAGE=$GRAPH_DIR/_helpers/merge${BASH_REMATCH[1]}-r=${BASH_REMATCH[2]}-k=${BASH_REMATCH[3]}-n=${BASH_REMATCH[4]}-m=${BASH_REMATCH[5]}.ei
+	mkdir -p $GRAPH_DIR/_helpers
+
+	./isoreduce -q -a -I$STAGE.store -r${BASH_REMATCH[2]} -k${BASH_REMATCH[3]} -n${BASH_REMATCH[4]} -m${BASH_REMATCH[5]} -o$STAGE -f$1
+	if [ $? -ne 0 ];then
+		echo -e "${COLOR_ERROR}FATAL: could not merge $1 into $STAGE${COLOR_RESET}"
+		exit 1
+	fi
+	rm $1
+}
+
+# Direct mode, lpsolve builds one model per graph in $1 in memory.
+# Models that hit a limit are written as LPs and handled as files below.
+if [ -n "$2" ];then
+	if [ "$3" = "-double" ];then
+		DOUBLE="-d"
+	fi
+	date
+	echo -e "${COLOR_INFO}$LPSOLVE -q $DOUBLE $SYMMETRY -j$LPJOBS $LPLIMITS -M$2 -D$GRAPH_DIR $LPFILE${COLOR_RESET}"
+	UNSOLVED=0
+	while read STATUS FILE;do
+		if [ "$STATUS" = "Solved:" ];then
+			store_soln $FILE
+		elif [ "$STATUS" = "Unfinished:" ];then
+			echo -e "${COLOR_WARNING}Limit reached for `basename $FILE`${COLOR_RESET}"
+			$0 $FILE
+			RET=$?
+			if [ $RET -eq 2 ];then
+				((UNSOLVED++))
+			elif [ $RET -ne 0 ];then
+				exit 1
+			fi
+		fi
+	done < <($LPSOLVE -q $DOUBLE $SYMMETRY -j$LPJOBS $LPLIMITS -M$2 -D$GRAPH_DIR -f $LPFILE)
+	wait $!
+	RETVAL=$?
+	if [ $RETVAL -ne 0 -a $RETVAL -ne 2 ];then
+		echo -e "${COLOR_ERROR}FATAL: $LPSOLVE returned $RETVAL when expanding $LPFILE${COLOR_RESET}"
+		exit 1
+	fi
+	if [ $UNSOLVED -gt 0 ];then
+		exit 2
+	fi
+	exit 0
+fi
 
 # try to solve linear program
 LPSOLUN=${LPFILE}.soln
 date
-echo -e "${COLOR_INFO}./lpsolve -av -T$LPTIMEOUT -t$LPTHREADS -s$LPMINSOLN -S$LPMAXSOLN -w$LPWRTBACK ${COLOR_RESET}"
-./lpsolve -av -T$LPTIMEOUT -t$LPTHREADS -s$LPMINSOLN -S$LPMAXSOLN $LPFILE -o$LPSOLUN -w$LPWRTBACK
+echo -e "${COLOR_INFO}$LPSOLVE -av -j$LPJOBS $LPLIMITS ${COLOR_RESET}"
+$LPSOLVE -av -j$LPJOBS $LPLIMITS $LPFILE -o$LPSOLUN
 RETVAL=$?
 
 
 cleanup() {
-	if [ ! -d $GRAPH_DIR/_solutions ];then
-		mkdir -p $GRAPH_DIR/_solutions
-	fi
-
 	rm $LPFILE
 
-	# don't keep zero byte files
-	find $LPSOLUN -empty -delete
-	if [ ! -f $LPSOLUN ];then
-		return
-	fi
-
-	gzip -f $LPSOLUN
-	if [ -e $GRAPH_DIR/_solutions/`basename ${LPSOLUN}.gz` ];then
-		echo -e "${COLOR_ERROR}Already exists: $GRAPH_DIR/_solutions/`basename ${LPSOLUN}.gz`${COLOR_RESET}"
-	fi
-	mv $LPMVARG ${LPSOLUN}.gz $GRAPH_DIR/_solutions/
+	store_soln $LPSOLUN
 }
 
 if [ $RETVAL -eq 0 ];then
@@ -153,6 +224,6 @@ elif [ $RETVAL -eq 2 ];then
 	exec $0 $SPLIT2
 
 else
-	echo -e "${COLOR_ERROR}FATAL: lpsolve returned $RETVAL when trying to solve $LPFILE${COLOR_RESET}"
+	echo -e "${COLOR_ERROR}FATAL: $LPSOLVE returned $RETVAL when trying to solve $LPFILE${COLOR_RESET}"
 	exit 1
 fi
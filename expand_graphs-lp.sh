@@ -34,17 +34,19 @@ if [ $# -ne 4 ];then
 	echo -e "usage: `basename $0` <r> <k> <N> <M>"
 	exit 1
 fi
-if [ -f $GRAPH_DIR/dontexist-$N-$M ];then
-	echo -e "${COLOR_WARNING}No expansions were possible for N=$N M=$M ${COLOR_RESET}"
-	exit 2
-fi
 
 if `basename $0 | grep -q double`;then
 	DUBSUF="-double"
+	DOUBLE="-d"
 else
 	DUBSUF=""
 fi
 
+# Levels done are looked up in the catalogue of $GRAPH_DIR, which
+# knows r, k and lambda.  The graph files of double coverings are
+# graphs-double-r=#-..., so that the runs of both can share it.
+KNOWN="./known -q -r$r -k$k $DOUBLE"
+
 
 mkdir -p $GRAPH_DIR/_helpers \
          $GRAPH_DIR/_solutions
@@ -53,12 +55,17 @@ mkdir -p $GRAPH_DIR/_helpers \
 echo -e "${COLOR_INFO}$0 $*${COLOR_RESET}"
 
 
-# Assume that all r-graphs on N vertices and M edges
-# have already been found if target file exists.
-TARGET_GRAPHS=$GRAPH_DIR/graphs-r=$r-k=$k-n=$N-m=$M.ei
-if [ -f $TARGET_GRAPHS ];then
+# All r-graphs on N vertices and M edges have
+# already been found if the catalogue says so.
+TARGET_GRAPHS=$GRAPH_DIR/graphs${DUBSUF}-r=$r-k=$k-n=$N-m=$M.ei
+$KNOWN -n$N -m$M
+RET=$?
+if [ $RET -eq 0 ];then
 	echo "$TARGET_GRAPHS already exists, skipping"
 	exit 0
+elif [ $RET -eq 2 ];then
+	echo -e "${COLOR_WARNING}No expansions were possible for N=$N M=$M ${COLOR_RESET}"
+	exit 2
 fi
 
 
@@ -69,7 +76,7 @@ minm=$((M - M*r/N))
 # Check for the required graphs
 MISSING=$((M+1))
 for edges in `seq $minm $M`;do
-	if [ ! -f $GRAPH_DIR/graphs-r=$r-k=$k-n=$n-m=$edges.ei ];then
+	if ! $KNOWN -n$n -m$edges;then
 		MISSING=$edges
 		break;
 	fi
@@ -81,8 +88,8 @@ if [ $MISSING -eq $minm ];then
 		# No expansion needed for graphs on the same number
 		# of vertices as the forbidden graph.
 		MAXM=`./nCk $k $r`
-		echo "./seed -C -r$r -k$k -M$((MAXM-$minm))"
-		./seed -C -r$r -k$k -M$((MAXM-$minm))
+		echo "./seed -C $DOUBLE -r$r -k$k -M$((MAXM-$minm))"
+		./seed -C $DOUBLE -r$r -k$k -M$((MAXM-$minm))
 	else
 		# Recursively run _this_script_ until we have
 		# all smaller graphs that we need.
@@ -96,15 +103,24 @@ if [ $MISSING -eq $minm ];then
 fi
 
 
-LPHEAD=$GRAPH_DIR/_helpers/lphead${DUBSUF}-r=${r}-k=${k}-N=${N}-M=${M}.lp
-if ! [ -f ${LPHEAD}.gz ];then
-	./lphead${DUBSUF} -qC -r$r -k$k -N$N -M$M -o- | gzip > ${LPHEAD}.gz
-	RET=$?
-	if [ $RET -ne 0 ];then
-		echo -e "${COLOR_ERROR}FATAL: ./lphead${DUBSUF} -qC -r$r -k$k -N$N -M$M -o-${COLOR_RESET}"
-		echo -e "${COLOR_ERROR}ret: $RET"
-		exit 1
-	fi
+if [ -f ~/.lpconfig ];then
+	source ~/.lpconfig
+fi
+
+# Every stage appends a record to the run log, see runlog.py, unless
+# LPRUNLOG=no
+if [ -z $LPRUNLOG ];then
+	export LPRUNLOG=$GRAPH_DIR/runlog
+fi
+
+# Build the models in memory in lpsolve unless LPDIRECT=no, in which
+# case the LPs are written as text by lpgraph.
+if [ -z $LPDIRECT ];then
+	LPDIRECT=yes
+fi
+# Symmetry breaking rows, isoreduce finds the same graphs either way
+if [ "$LPSYMMETRY" != "no" ];then
+	SYMMETRY="-y"
 fi
 
 UNSOLVED=0
@@ -113,16 +129,31 @@ UNSOLVED=0
 for m in `seq $M -1 $minm`; do
 
 	# Graphs to expand.
-	graph=$GRAPH_DIR/graphs-r=$r-k=$k-n=$n-m=$m.ei
-	if [ ! -f $graph ];then
+	graph=$GRAPH_DIR/graphs${DUBSUF}-r=$r-k=$k-n=$n-m=$m.ei
+	if ! $KNOWN -n$n -m$m;then
 		continue
 	fi
 	echo "expanding $graph"
 
+	if [ "$LPDIRECT" != "no" ];then
+		# One model per graph, built and solved by lpsolve.
+		./expand_graphs-lp-solver.sh $graph $M $DUBSUF
+		RET=$?
+
+		if [ $RET -eq 2 ];then
+			# LPSTOP=yes
+			((UNSOLVED++))
+		elif [ $RET -ne 0 ];then
+			echo -e "${COLOR_ERROR}FATAL: ./expand_graphs-lp-solver.sh $graph $M $DUBSUF did not exit cleanly${COLOR_RESET}"
+			exit 1
+		fi
+		continue
+	fi
+
 	# Each graph*.ei file may contain several graphs,
 	# we get one set on LP constraints from each graph.
 	i=0
-	for LPGRAPH in `./lpgraph -M${M} -v $graph -D$GRAPH_DIR/_helpers \
+	for LPGRAPH in `./lpgraph -R $DOUBLE $SYMMETRY -M${M} -v $graph -D$GRAPH_DIR/_helpers \
 		| grep Writing \
 		| cut -d: -f3`
 	do
@@ -130,14 +161,13 @@ for m in `seq $M -1 $minm`; do
 
 		if [ ! -f $LPGRAPH ];then
 			echo -e "${COLOR_ERROR}FATAL: $LPGRAPH missing${COLOR_RESET}"
-			echo -e "${COLOR_ERROR}./lpgraph -M${M} -v $graph -D$GRAPH_DIR/_helpers${COLOR_RESET}"
+			echo -e "${COLOR_ERROR}./lpgraph -R $DOUBLE $SYMMETRY -M${M} -v $graph -D$GRAPH_DIR/_helpers${COLOR_RESET}"
 			echo -e "${COLOR_ERROR}should have produced this file.${COLOR_RESET}"
 			exit 1
 		fi
 
 		# Create LP.
-		cat ${LPHEAD}.gz > ${LPFILE}.gz
-		cat ${LPGRAPH} | gzip >> ${LPFILE}.gz
+		gzip -c ${LPGRAPH} > ${LPFILE}.gz
 		rm ${LPGRAPH}
 
 		./expand_graphs-lp-solver.sh ${LPFILE}.gz
@@ -166,38 +196,44 @@ if [ $UNSOLVED -gt 0 ];then
 	exit 1
 fi
 
-if ! which shortg > /dev/null 2>&1;then
-	PATH=$PATH:.
-fi
-
-FILES=`find $GRAPH_DIR/_solutions | grep "N=${N}-M=${M}" | wc -l`
-
-if [ $FILES -gt 0 ]
-then
-	echo -e "${COLOR_INFO} piping all solutions for N=$N M=$M to ./isoreduce -v -r$r -k$k -n$N -m$M -o${TARGET_GRAPHS}${COLOR_RESET}"
-	find $GRAPH_DIR/_solutions/ \
-		| grep "N=${N}-M=${M}" \
-		| xargs zcat \
-		| ./isoreduce -v -r$r -k$k -n$N -m$M -o$TARGET_GRAPHS
+# The solutions were merged into the stage as the LPs were solved, see
+# store_soln in expand_graphs-lp-solver.sh, only those an older run left
+# in _solutions are merged here, gzipped or not, as turan leaves them
+# raw.  The stage is then the target.
+STAGE=$GRAPH_DIR/_helpers/merge${DUBSUF}-r=$r-k=$k-n=$N-m=$M.ei
+mkdir -p $GRAPH_DIR/_helpers
+
+for SOLN in `find $GRAPH_DIR/_solutions/ -type f 2>/dev/null | grep "N=${N}-M=${M}"`
+do
+	echo -e "${COLOR_INFO}merging $SOLN into $STAGE${COLOR_RESET}"
+	zcat -f $SOLN | ./isoreduce -q -a -I$STAGE.store -r$r -k$k -n$N -m$M -o$STAGE
 	RET=${PIPESTATUS[*]}
-	if [ "$RET" != "0 0 0 0" ];then
+	if [ "$RET" != "0 0" ];then
 		echo -e "${COLOR_ERROR}isoreduce did not exit cleanly${COLOR_RESET}"
-		echo -e "${COLOR_ERROR}exit statuses: $RET (find grep xargs isoreduce)${COLOR_RESET}"
+		echo -e "${COLOR_ERROR}exit statuses: $RET (zcat -f isoreduce)${COLOR_RESET}"
 		exit 1
 	fi
-fi
+	rm $SOLN
+done
 
-find $GRAPH_DIR/_solutions/ \
-	| grep "N=${N}-M=${M}" \
-	| xargs rm
+if [ -f $STAGE ];then
+	mv $STAGE $TARGET_GRAPHS
+fi
+rm -f $STAGE.store
 
 find $TARGET_GRAPHS -empty -delete 2>/dev/null
 
+# complete, or empty if there is no target file
+$KNOWN -a -n$N -m$M
+if [ $? -eq 1 ];then
+	echo -e "${COLOR_ERROR}FATAL: could not catalogue N=$N M=$M${COLOR_RESET}"
+	exit 1
+fi
+
 if [ -f $TARGET_GRAPHS ];then
 	echo -e "${COLOR_GOOD}All non-isomorphic K_$k-free $r-graphs on $N vertices and $M edges have been found${COLOR_RESET}"
 	exit 0
 else
 	echo -e "${COLOR_WARNING}No expansions were possible for N=$N M=$M ${COLOR_RESET}"
-	echo "No expansions were possible for N=$N M=$M" > $GRAPH_DIR/dontexist-$N-$M
 	exit 2
 fi
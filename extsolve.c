@@ -0,0 +1,697 @@
+/*
+ * Copyright © 2011,2012,2013 Lars Lindqvist <lars.lindqvist at yandex.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Enumerates the 0/1 solutions of the expansion programs without an
+   ILP solver.  Every row of these programs is a sum of distinct
+   variables compared to a constant, so a row with as many ones as
+   its bound forces its other variables to 0, and one that needs all
+   of its unassigned variables forces them to 1.  The search assigns
+   one variable at a time and propagates this until every variable
+   is assigned or a row can't be satisfied. */
+
+#include "util.h"
+#include "graphfile.h"
+#include "lp.h"
+
+static void
+usage(const char *prog) {
+	fprintf(stdout,
+		"usage: %s -f filename [-a] [-D directory] [-q] [-C] [-o filename]\n"
+		"       %s -M# [-d] [-y] [-j#] [-r# -k# -n# -m#] -f graphs [options as above]\n"
+		"	mandatory arguments\n"
+		"    -f, linear program to solve, as written by lphead and lpgraph,\n"
+		"	     gzipped if the name ends with .gz\n"
+		"	 -M, expand the graphs in file to graphs on n+1 vertices and M edges,\n"
+		"	     as lpsolve -M does.  For every graph a line `Solved: file'\n"
+		"	     naming its solutions is printed\n"
+		"   optional arguments\n"
+		"	 -d, double coverings, as with lphead-double\n"
+		"	 -y, with -M, break the symmetries of each graph, as lpgraph -y\n"
+		"	 -j, with -M, number of graphs to solve in parallel\n"
+		"	 -a, append solutions to output file\n"
+		"    -o, write output to file, use ``-'' for stdout, not with -M\n"
+		"	 -q, quiet, surppress misc output\n"
+		"	 -C, don't clobber output file\n"
+		"	misc: Output is the same as that of lpsolve, all solutions are\n"
+		"	      always found, there are no time or solution limits.\n"
+		"	      Output directory will be choosen by:\n"
+		"	      1) command line argument -D\n"
+		"	      2) environment variable $GRAPH_DIR\n"
+		"	      3) compile time definition OUTDIR=" OUTDIR "\n"
+		"	      Default output filename is the input filename suffixed with ``.soln'',\n"
+		"	      with -M `solve-r=#-k=#-n=#-m=#-N=#-M=#_no=#.lp.soln'\n", prog, prog);
+
+	exit(EXIT_FAILURE);
+}
+
+/* Rows are kept in CSR form, the variables of row i are
+   ind[start[i]], ..., ind[start[i + 1] - 1].  The rows of each
+   variable are indexed the same way by ready(). */
+typedef struct {
+	uint nvars;
+	uint nrows;
+	uint *start;
+	uint *ind;
+	char *sense;
+	int *rhs;
+	uint rows_size;
+	uint ind_size;
+
+	uint *var_start;
+	uint *var_rows;
+
+	signed char *val;	/* 0, 1 or -1 if unassigned */
+	int *ones;		/* per row, variables assigned 1 */
+	uint *unset;		/* per row, unassigned variables */
+	uint *trail;		/* assigned variables, in order */
+	uint ntrail;
+	uint done;		/* trail[0 .. done) are counted in ones and unset */
+
+	FILE *out;
+	ulong solutions;
+} Ext;
+
+static Ext *
+ext_alloc() {
+	Ext *X;
+
+	X = g_calloc(1, sizeof(Ext));
+	X->rows_size = 1024;
+	X->ind_size = 8192;
+	X->start = g_malloc((X->rows_size + 1) * sizeof(uint));
+	X->sense = g_malloc(X->rows_size * sizeof(char));
+	X->rhs = g_malloc(X->rows_size * sizeof(int));
+	X->ind = g_malloc(X->ind_size * sizeof(uint));
+	X->start[0] = 0;
+
+	return X;
+}
+
+static void
+ext_free(Ext * X) {
+	free(X->start);
+	free(X->ind);
+	free(X->sense);
+	free(X->rhs);
+	free(X->var_start);
+	free(X->var_rows);
+	free(X->val);
+	free(X->ones);
+	free(X->unset);
+	free(X->trail);
+	free(X);
+}
+
+static void
+add_row(Ext * X, uint nz, uint * ind, char sense, int rhs) {
+	uint i;
+
+	if (X->nrows == X->rows_size) {
+		X->rows_size *= 2;
+		X->start = g_realloc(X->start, (X->rows_size + 1) * sizeof(uint));
+		X->sense = g_realloc(X->sense, X->rows_size * sizeof(char));
+		X->rhs = g_realloc(X->rhs, X->rows_size * sizeof(int));
+	}
+	while (X->start[X->nrows] + nz > X->ind_size) {
+		X->ind_size *= 2;
+		X->ind = g_realloc(X->ind, X->ind_size * sizeof(uint));
+	}
+
+	for (i = 0; i < nz; i++) {
+		X->ind[X->start[X->nrows] + i] = ind[i];
+		if (ind[i] >= X->nvars)
+			X->nvars = ind[i] + 1;
+	}
+	X->sense[X->nrows] = sense;
+	X->rhs[X->nrows] = rhs;
+	X->nrows++;
+	X->start[X->nrows] = X->start[X->nrows - 1] + nz;
+}
+
+static void
+ext_row(Lpsink * sink, uint nz, uint * ind, char sense, int rhs) {
+	add_row(sink->arg, nz, ind, sense, rhs);
+}
+
+/* x_i >= x_j is kept as a row of sense 'o' */
+static void
+ext_order(Lpsink * sink, uint i, uint j) {
+	uint ind[2];
+
+	ind[0] = i;
+	ind[1] = j;
+	add_row(sink->arg, 2, ind, 'o', 0);
+}
+
+/* Index the rows of every variable, and clear the search state */
+static void
+ready(Ext * X) {
+	uint i, j, *fill;
+
+	X->var_start = g_calloc(X->nvars + 1, sizeof(uint));
+	X->var_rows = g_malloc(X->start[X->nrows] * sizeof(uint) + 1);
+	for (i = 0; i < X->start[X->nrows]; i++)
+		X->var_start[X->ind[i] + 1]++;
+	for (i = 0; i < X->nvars; i++)
+		X->var_start[i + 1] += X->var_start[i];
+	fill = g_calloc(X->nvars, sizeof(uint));
+	for (i = 0; i < X->nrows; i++)
+		for (j = X->start[i]; j < X->start[i + 1]; j++)
+			X->var_rows[X->var_start[X->ind[j]] + fill[X->ind[j]]++] = i;
+	free(fill);
+
+	X->val = g_malloc(X->nvars * sizeof(signed char));
+	memset(X->val, -1, X->nvars);
+	X->trail = g_malloc(X->nvars * sizeof(uint) + 1);
+	X->ones = g_calloc(X->nrows, sizeof(int));
+	X->unset = g_malloc(X->nrows * sizeof(uint) + 1);
+	for (i = 0; i < X->nrows; i++)
+		X->unset[i] = X->start[i + 1] - X->start[i];
+	X->ntrail = X->done = 0;
+	X->solutions = 0;
+}
+
+/* Returns 0 if v is already assigned the other value */
+static int
+assign(Ext * X, uint v, int b) {
+	if (X->val[v] >= 0)
+		return X->val[v] == b;
+	X->val[v] = b;
+	X->trail[X->ntrail++] = v;
+	return 1;
+}
+
+/* Check row i, assigning whatever it forces.  Returns 0 if it can't
+   be satisfied. */
+static int
+check_row(Ext * X, uint i) {
+	int lo = X->ones[i], hi = X->ones[i] + (int)X->unset[i], b;
+	uint j;
+
+	switch (X->sense[i]) {
+	case 'o':
+		j = X->start[i];
+		if (X->val[X->ind[j + 1]] == 1)
+			return assign(X, X->ind[j], 1);
+		if (X->val[X->ind[j]] == 0)
+			return assign(X, X->ind[j + 1], 0);
+		return 1;
+	case '<':
+		if (lo > X->rhs[i])
+			return 0;
+		if (lo < X->rhs[i])
+			return 1;
+		b = 0;
+		break;
+	case '>':
+		if (hi < X->rhs[i])
+			return 0;
+		if (hi > X->rhs[i])
+			return 1;
+		b = 1;
+		break;
+	default:
+		if (lo > X->rhs[i] || hi < X->rhs[i])
+			return 0;
+		if (lo < X->rhs[i] && hi > X->rhs[i])
+			return 1;
+		b = lo < X->rhs[i];
+	}
+
+	if (X->unset[i])
+		for (j = X->start[i]; j < X->start[i + 1]; j++)
+			if (X->val[X->ind[j]] < 0)
+				assign(X, X->ind[j], b);
+	return 1;
+}
+
+/* Count the assignments not yet counted, checking their rows */
+static int
+propagate(Ext * X) {
+	uint v, j, i;
+
+	while (X->done < X->ntrail) {
+		v = X->trail[X->done++];
+		for (j = X->var_start[v]; j < X->var_start[v + 1]; j++) {
+			i = X->var_rows[j];
+			X->unset[i]--;
+			X->ones[i] += X->val[v];
+		}
+		for (j = X->var_start[v]; j < X->var_start[v + 1]; j++)
+			if (!check_row(X, X->var_rows[j]))
+				return 0;
+	}
+	return 1;
+}
+
+/* Undo the assignments after the first t */
+static void
+undo(Ext * X, uint t) {
+	uint v, j, i;
+
+	while (X->ntrail > t) {
+		v = X->trail[--X->ntrail];
+		if (X->ntrail < X->done) {
+			for (j = X->var_start[v]; j < X->var_start[v + 1]; j++) {
+				i = X->var_rows[j];
+				X->unset[i]++;
+				X->ones[i] -= X->val[v];
+			}
+		}
+		X->val[v] = -1;
+	}
+	X->done = t;
+}
+
+static void
+write_soln(Ext * X) {
+	uint v;
+
+	for (v = 0; v < X->nvars; v++)
+		if (X->val[v] == 1)
+			fprintf(X->out, "%u ", v);
+	fputc('\n', X->out);
+	X->solutions++;
+}
+
+/* All solutions with the variables before `from' as assigned */
+static void
+search(Ext * X, uint from) {
+	uint t = X->ntrail;
+	int b;
+
+	while (from < X->nvars && X->val[from] >= 0)
+		from++;
+	if (from == X->nvars) {
+		write_soln(X);
+		return;
+	}
+
+	for (b = 1; b >= 0; b--) {
+		assign(X, from, b);
+		if (propagate(X))
+			search(X, from + 1);
+		undo(X, t);
+	}
+}
+
+/* Write all solutions to fp, returns how many there are */
+static ulong
+solve_all(Ext * X, FILE * fp) {
+	uint i;
+	int ok = 1;
+
+	X->out = fp;
+	ready(X);
+	for (i = 0; ok && i < X->nrows; i++)
+		ok = check_row(X, i);
+	if (ok && propagate(X))
+		search(X, 0);
+
+	if (!options->quiet) {
+		if (X->solutions == 1)
+			infomsg("Found %lu graph\n", X->solutions);
+		else
+			infomsg("Found %lu graphs\n", X->solutions);
+	}
+	return X->solutions;
+}
+
+/* Run log record of X, as lpsolve's.  It's always solved. */
+static void
+log_lp(Ext * X, const char *path, Runclock * clock, uint N, uint M, long bytes) {
+	char *p = json_escape(path);
+
+	runlog("extsolve", clock, "\"lp\": \"%s\", \"N\": %u, \"M\": %u, \"vars\": %u, \"rows\": %u, "
+	       "\"status\": \"solved\", \"solutions\": %lu, \"bytes\": %ld", p, N, M, X->nvars, X->nrows,
+	       X->solutions, bytes);
+	free(p);
+}
+
+/* Shared by the workers of solve_graphs() */
+typedef struct {
+	Graphfile *in;
+	Complete_graph *K, *K_p;
+	uint r, k, n, m, M;
+	uint graph_no;
+	int retval;
+	pthread_mutex_t lock;
+} batch_t;
+
+/* Take graphs from the input file until it's empty */
+static void *
+solve_worker(void *p) {
+	batch_t *B = p;
+	Ext *X;
+	Lpsink sink;
+	Graph *g;
+	FILE *fp;
+	char *path;
+	size_t len;
+	uint graph_no;
+	int more;
+	long bytes;
+	Runclock clock;
+
+	len = strlen(options->graph_dir) + 128;
+	path = g_malloc(len);
+
+	g = Galloc(B->K->n, B->m);
+	for (;;) {
+		pthread_mutex_lock(&B->lock);
+		more = B->retval != EXIT_FAILURE && graphfile_read_into(B->in, B->K, g);
+		graph_no = B->graph_no++;
+		if (more) {
+			snprintf(path, len, "%s/solve%s-r=%u-k=%u-n=%u-m=%u-N=%u-M=%u_no=%u.lp",
+				 options->graph_dir, options->lambda == 2 ? "-double" : "",
+				 B->r, B->k, B->n, B->m, B->n + 1, B->M, graph_no);
+			fp = open_outfile("%s.soln", path);
+		}
+		pthread_mutex_unlock(&B->lock);
+		if (!more)
+			break;
+		if (!fp) {	/* should only happen if output file exists and noclobber is set */
+			if (!options->quiet)
+				infomsg("NOTICE: No output file for graph no. %u, skipping\n", graph_no);
+			continue;
+		}
+
+		runclock_start(&clock);
+		clock.shared = options->jobs > 1;
+		bytes = file_bytes(fp);
+		X = ext_alloc();
+		sink.row = ext_row;
+		sink.order = ext_order;
+		sink.arg = X;
+		lp_reduced_rows(g, B->K, B->K_p, B->k, B->M, options->lambda, &sink);
+		if (options->symmetry)
+			lp_symmetry_rows(g, B->K, B->K_p, &sink);
+		X->nvars = B->K_p->m;
+		solve_all(X, fp);
+		log_lp(X, path, &clock, B->n + 1, B->M, file_bytes(fp) - bytes);
+		ext_free(X);
+		f_close(fp);
+
+		pthread_mutex_lock(&B->lock);
+		fprintf(stdout, "Solved: %s.soln\n", path);
+		fflush(stdout);
+		pthread_mutex_unlock(&B->lock);
+	}
+
+	free_G(g);
+	free(path);
+
+	return NULL;
+}
+
+/* Expand every graph of the input file, see usage() */
+static int
+solve_graphs() {
+	batch_t B;
+	pthread_t *tids;
+	uint i, dummy;
+	Runclock clock;
+
+	runclock_start(&clock);
+	B.in = graphfile_open_in();
+	B.r = B.k = B.n = B.m = 0;
+	if (!graphfile_params(B.in, &B.r, &B.k, &B.n, &B.m) && options->infile)
+		parse_infile(&B.r, &B.k, &B.n, &B.m, &dummy, &dummy, PFN_r | PFN_k | PFN_n | PFN_m);
+	if (((!B.r && !(B.r = options->forbidden.r))
+	     || (!B.k && !(B.k = options->forbidden.k))
+	     || (!B.n && !(B.n = options->n))
+	     || (!B.m && !(B.m = options->m))))
+		usage("extsolve");
+	B.M = options->target_m;
+
+	B.K = complete_graph(B.n, B.r);
+	B.K_p = complete_graph(B.n + 1, B.r);
+	B.graph_no = 0;
+	B.retval = EXIT_SUCCESS;
+	pthread_mutex_init(&B.lock, NULL);
+
+	tids = g_malloc(options->jobs * sizeof(pthread_t));
+	for (i = 0; i < options->jobs; i++)
+		if ((errno = pthread_create(tids + i, NULL, solve_worker, &B))) {
+			errmsg("FATAL: pthread_create: %s\n", strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+	for (i = 0; i < options->jobs; i++)
+		pthread_join(tids[i], NULL);
+
+	/* The records of the graphs are shared, this one has the cpu
+	   time and size of them all */
+	if (options->jobs > 1)
+		runlog("batch", &clock, "\"solver\": \"extsolve\", \"N\": %u, \"M\": %u, \"jobs\": %u",
+		       B.n + 1, B.M, options->jobs);
+
+	if (read_line_errno)
+		B.retval = EXIT_FAILURE;
+
+	pthread_mutex_destroy(&B.lock);
+	free(tids);
+	free_K(B.K);
+	free_K(B.K_p);
+	graphfile_close(B.in);
+
+	return B.retval;
+}
+
+/* Variable index of token x#, or -1 */
+static long
+var_index(const char *tok) {
+	char *end;
+	long v;
+
+	if (tok[0] != 'x' || !isdigit((unsigned char)tok[1]))
+		return -1;
+	v = strtol(tok + 1, &end, 10);
+	return *end ? -1 : v;
+}
+
+static int
+is_sense(const char *tok) {
+	return !strcmp(tok, "<=") || !strcmp(tok, "=<") || !strcmp(tok, "<")
+	    || !strcmp(tok, ">=") || !strcmp(tok, "=>") || !strcmp(tok, ">")
+	    || !strcmp(tok, "=");
+}
+
+/* Sense of an LP file comparison, one of '<', '=' and '>' */
+static char
+lp_sense(const char *tok) {
+	return tok[0] == '=' && tok[1] ? tok[1] : tok[0];
+}
+
+/* Read an LP file in the format of lphead, lpgraph and gurobi, as
+   long as all coefficients are 1, except in the rows x_i - x_j >= 0
+   of lpgraph -y.  Returns 0 on parse errors. */
+static int
+read_lp(Ext * X, FILE * fp) {
+	enum { OBJECTIVE, ROWS, BOUNDS, TYPES } section = OBJECTIVE;
+	char tok[64], sense = 0;
+	uint *ind, nz = 0, size = 1024, bound, minus = 0, neg = 0;
+	long v, var = -1;
+	int num = 0, have_num = 0, inf, ok = 1, sign = 1;
+
+	ind = g_malloc(size * sizeof(uint));
+	while (ok && fscanf(fp, " %63s", tok) == 1) {
+		if (!strcmp(tok, "End"))
+			break;
+		if (!strcmp(tok, "Subject") || !strcmp(tok, "st") || !strcmp(tok, "s.t.")) {
+			section = ROWS;
+			continue;
+		}
+		if (section == ROWS && !nz && !sense && (!strcmp(tok, "To") || !strcmp(tok, "to")))
+			continue;
+		if (!strcmp(tok, "Bounds")) {
+			section = BOUNDS;
+			sense = 0;
+			continue;
+		}
+		if (!strcmp(tok, "Binaries") || !strcmp(tok, "Binary")
+		    || !strcmp(tok, "Generals") || !strcmp(tok, "General")) {
+			section = TYPES;
+			continue;
+		}
+		v = var_index(tok);
+		if (v >= 0 && (ulong)v >= X->nvars)
+			X->nvars = v + 1;
+
+		switch (section) {
+		case OBJECTIVE:
+		case TYPES:
+			break;
+
+		case ROWS:
+			if (sense) {
+				ok = sscanf(tok, "%d", &num) == 1;
+				if (!minus) {
+					add_row(X, nz, ind, sense, num);
+				} else if (nz == 2 && minus == 1 && num == 0 && sense != '=') {
+					/* x_i - x_j >= 0, or the same the other way round */
+					if ((neg == 0) == (sense == '>')) {
+						bound = ind[0];
+						ind[0] = ind[1];
+						ind[1] = bound;
+					}
+					add_row(X, 2, ind, 'o', 0);
+				} else {
+					ok = 0;
+				}
+				nz = minus = 0;
+				sense = 0;
+			} else if (v >= 0) {
+				if (nz == size) {
+					size *= 2;
+					ind = g_realloc(ind, size * sizeof(uint));
+				}
+				if (sign < 0) {
+					minus++;
+					neg = nz;
+				}
+				sign = 1;
+				ind[nz++] = v;
+			} else if (is_sense(tok)) {
+				sense = lp_sense(tok);
+			} else if (!strcmp(tok, "-")) {
+				sign = -1;
+			} else if (tok[strlen(tok) - 1] != ':' && strcmp(tok, "+") && strcmp(tok, "1")) {
+				ok = 0;
+			}
+			break;
+
+		case BOUNDS:
+			/* x# <= b, x# >= b, x# = b, a <= x# <= b or x# free,
+			   an infinite a or b is no bound at all */
+			inf = strstr(tok, "inf") || strstr(tok, "Inf");
+			if (is_sense(tok)) {
+				sense = lp_sense(tok);
+			} else if (v >= 0) {
+				if (have_num && sense) {
+					bound = v;
+					add_row(X, 1, &bound, sense == '<' ? '>' : sense == '>' ? '<' : '=', num);
+				}
+				have_num = 0;
+				sense = 0;
+				var = v;
+			} else if (!strcmp(tok, "free")) {
+				var = -1;
+			} else if (inf || sscanf(tok, "%d", &num) == 1) {
+				if (var >= 0 && sense && !inf) {
+					bound = var;
+					add_row(X, 1, &bound, sense, num);
+				}
+				have_num = var < 0 && !inf;
+				var = -1;
+				sense = 0;
+			} else {
+				ok = 0;
+			}
+			break;
+		}
+	}
+	if (section == OBJECTIVE)
+		ok = 0;
+	if (!ok || nz)
+		errmsg("ERROR: Can't read LP, at `%s'\n", tok);
+
+	free(ind);
+	return ok && !nz;
+}
+
+int
+main(int argc, char *argv[]) {
+	Ext *X;
+	FILE *fp, *lp;
+	char *out_filename, *cmd;
+	size_t len;
+	int gz, ok;
+	uint N = 0, M = 0, dummy;
+	long bytes;
+	Runclock clock;
+
+	init(argc, argv, "qvf:aD:o:Cr:k:n:m:M:dj:y");
+
+	if (options->help)
+		usage(argv[0]);
+	/* every graph of -M has its own output file */
+	if (options->target_m && !options->use_default_outfile) {
+		errmsg("FATAL: -o can't be used with -M\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (options->target_m)
+		return solve_graphs();
+
+	if (!options->infile)
+		usage(argv[0]);
+
+	runclock_start(&clock);
+	parse_infile(&dummy, &dummy, &dummy, &dummy, &N, &M, PFN_N | PFN_M);
+	len = strlen(options->infile);
+	gz = len > 3 && !strcmp(options->infile + len - 3, ".gz");
+	if (gz) {
+		cmd = g_malloc(len + 32);
+		snprintf(cmd, len + 32, "gzip -dc '%s'", options->infile);
+		lp = popen(cmd, "r");
+		free(cmd);
+		if (!lp) {
+			errmsg("FATAL: popen: %s\n", strerror(errno));
+			return EXIT_FAILURE;
+		}
+	} else {
+		lp = f_open(options->infile, "r");
+	}
+
+	X = ext_alloc();
+	ok = read_lp(X, lp);
+	if (gz) {
+		if (pclose(lp) != 0)
+			ok = 0;
+	} else {
+		f_close(lp);
+	}
+	if (!ok)
+		return EXIT_FAILURE;
+
+	len = strlen(options->infile) + strlen(".soln") + 1;
+	out_filename = g_malloc(len);
+	snprintf(out_filename, len, "%s.soln", options->infile);
+
+	fp = open_outfile("%s/%s", options->graph_dir, basename(out_filename));
+	if (!fp) {		/* should only happen if output file exists and noclobber is set */
+		if (!options->quiet)
+			infomsg("NOTICE: No output file, exiting\n");
+		return 0;
+	}
+
+	free(out_filename);
+
+	bytes = file_bytes(fp);
+	solve_all(X, fp);
+	log_lp(X, options->infile, &clock, N, M, file_bytes(fp) - bytes);
+	ext_free(X);
+
+	f_close(fp);
+
+	return EXIT_SUCCESS;
+}
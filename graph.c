@@ -22,9 +22,8 @@
 
 #include "graph.h"
 #include "util.h"
-#ifndef SHORTG_BIN
-#define SHORTG_BIN "./shortg"
-#endif
+#include "canon.h"
+#include "certset.h"
 
 /* Write edge indices of graph to file, indices are with regards to
    lexicographical ordering of edges in the complete graph on the
@@ -74,6 +73,39 @@ writegs_ei(Graph * g, FILE * fp) {
 		writeg_ei(tmp, fp);
 }
 
+void
+writebatch_ei(GraphBatch * B, FILE * fp) {
+	Graph g;
+	uint i;
+
+	for (i = 0; i < B->n; i++) {
+		batch_graph(B, i, &g);
+		writeg_ei(&g, fp);
+	}
+}
+
+void
+writebatch(GraphBatch * B, Complete_graph * K, FILE * fp) {
+	Graph g;
+	uint i;
+
+	for (i = 0; i < B->n; i++) {
+		batch_graph(B, i, &g);
+		writeg(&g, K, fp);
+	}
+}
+
+/* One sparse6 string per line, see batch_set_s6() */
+void
+writebatch_s6(GraphBatch * B, FILE * fp) {
+	uint i;
+
+	for (i = 0; i < B->n; i++) {
+		fputs(BATCH_S6(B, i), fp);
+		fputc('\n', fp);
+	}
+}
+
 void
 printg(Graph * g, Complete_graph * K) {
 	writeg(g, K, stdout);
@@ -105,6 +137,32 @@ vertex_is_in_edge(vertex n, vertex * edge, uint r) {
 	return 0;
 }
 
+/* The edges of K containing vertex v, *len of them */
+uint *
+edges_containing(Complete_graph * K, vertex v, uint * len) {
+	*len = K->inc_start[v + 1] - K->inc_start[v];
+	return K->inc + K->inc_start[v];
+}
+
+/* The edges of K containing the s vertices of the sorted set, in
+   increasing order, to out.  Returns how many there are. */
+uint
+edges_containing_set(Complete_graph * K, vertex * set, uint s, uint * out) {
+	uint *inc, len, i, j, l, n = 0;
+	vertex *edge;
+
+	inc = edges_containing(K, set[0], &len);
+	for (i = 0; i < len; i++) {
+		edge = K->edges + (size_t)inc[i] * K->r;
+		for (j = l = 0; j < K->r && l < s; j++)
+			if (edge[j] == set[l])
+				l++;
+		if (l == s)
+			out[n++] = inc[i];
+	}
+	return n;
+}
+
 /* smallest valency of graph g */
 uint
 delta(Graph * g, Complete_graph * K) {
@@ -155,6 +213,7 @@ get_vertex_degrees(Graph * g, Complete_graph * K) {
 Complete_graph *
 Kalloc(vertex n, uint r) {
 	Complete_graph *K;
+	uint a, b;
 
 	K = g_malloc(sizeof(Complete_graph));
 	K->n = n;
@@ -162,6 +221,19 @@ Kalloc(vertex n, uint r) {
 	K->m = nCk((uint) n, r);
 	K->edge_len = r * sizeof(vertex);
 	K->edges = g_malloc(K->m * K->edge_len);
+	K->words = BITS_WORDS(K->m);
+	K->inc = NULL;
+	K->inc_start = NULL;
+
+	/* Pascal's triangle, unsigned overflow in entries never
+	   used for ranking is harmless */
+	K->binom = g_calloc((n + 1) * (r + 1), sizeof(ulong));
+	for (a = 0; a <= n; a++) {
+		K->binom[a * (r + 1)] = 1;
+		for (b = 1; b <= r && b <= a; b++)
+			K->binom[a * (r + 1) + b] = K->binom[(a - 1) * (r + 1) + b - 1]
+			 + (b < a ? K->binom[(a - 1) * (r + 1) + b] : 0);
+	}
 
 	return K;
 }
@@ -172,8 +244,10 @@ Galloc(vertex n, uint m) {
 	(void)n;		/* gcc warning */
 
 	tmp = g_malloc(sizeof(Graph));
-	tmp->edges = g_malloc(m * sizeof(uint));
+	tmp->edges = g_malloc((m ? m : 1) * sizeof(uint));
 	tmp->m = m;
+	tmp->s6 = NULL;
+	tmp->bits = NULL;
 	tmp->next = NULL;
 
 	return tmp;
@@ -190,6 +264,9 @@ free_K(Complete_graph * G) {
 		return;
 	}
 	free(G->edges);
+	free(G->binom);
+	free(G->inc);
+	free(G->inc_start);
 	free(G);
 }
 
@@ -204,13 +281,100 @@ free_G(Graph * G) {
 		return;
 	}
 	free(G->edges);
+	free(G->bits);
 	free(G);
 }
 
-static unsigned char
+/* Empty batch of graphs on m edges, with room for size graphs */
+GraphBatch *
+batch_alloc(uint m, uint size) {
+	GraphBatch *B;
+
+	B = g_malloc(sizeof(GraphBatch));
+	B->n = 0;
+	B->size = size ? size : 1;
+	B->m = m;
+	B->edges = g_malloc(((size_t)B->size * m + 1) * sizeof(uint));
+	B->s6 = NULL;
+	B->s6_len = 0;
+
+	return B;
+}
+
+/* Append a graph to B, returns where to put its m edges.  This may
+   move the edges of B, so earlier views into B become invalid. */
+uint *
+batch_add(GraphBatch * B) {
+	if (B->n == B->size) {
+		B->size *= 2;
+		B->edges = g_realloc(B->edges, ((size_t)B->size * B->m + 1) * sizeof(uint));
+	}
+	return BATCH_EDGES(B, B->n++);
+}
+
+/* Let g be a view of graph i of B, without any allocation, for
+   functions taking a Graph.  Anything they put in g->bits or g->s6
+   belongs to the caller. */
+void
+batch_graph(GraphBatch * B, uint i, Graph * g) {
+	g->edges = BATCH_EDGES(B, i);
+	g->m = B->m;
+	g->s6 = NULL;
+	g->bits = NULL;
+	g->next = NULL;
+}
+
+void
+free_batch(GraphBatch * B) {
+	free(B->edges);
+	free(B->s6);
+	free(B);
+}
+
+/* Allocate an empty edge set large enough for any subgraph of K */
+ulong *
+Balloc(Complete_graph * K) {
+	return g_calloc(K->words, sizeof(ulong));
+}
+
+/* Fill in the bitset representation of g, unless already done */
+void
+set_bits(Graph * g, Complete_graph * K) {
+	uint i;
+
+	if (g->bits)
+		return;
+
+	g->bits = Balloc(K);
+	for (i = 0; i < g->m; i++)
+		BIT_SET(g->bits, g->edges[i]);
+}
+
+/* Graph on the m edges set in `bits', indices in increasing order */
+Graph *
+bits2graph(ulong * bits, uint m, Complete_graph * K) {
+	Graph *ret;
+	ulong w;
+	uint i, j;
+
+	ret = Galloc(K->n, m);
+	for (j = i = 0; i < K->words; i++)
+		for (w = bits[i]; w; w &= w - 1) {
+			assert(j < m);
+			ret->edges[j++] = i * WORD_BITS + __builtin_ctzll(w);
+		}
+	assert(j == m);
+
+	return ret;
+}
+
+int
 edge_is_in_graph(uint edge, Graph * g) {
 	uint i;
 
+	if (g->bits)
+		return BIT_ISSET(g->bits, edge);
+
 	for (i = 0; i < g->m; i++) {
 		if (edge == g->edges[i])
 			return 1;
@@ -218,24 +382,31 @@ edge_is_in_graph(uint edge, Graph * g) {
 	return 0;
 }
 
-static uint
-edge_index(Complete_graph * K, vertex * edge2) {
-	uint i;
-	vertex *edge1;
+/* Index of the sorted r-set `edge' in the lexicographical ordering
+   of the edges of K, by the combinatorial number system.
+   An edge {c_0 < ... < c_{r-1}} has as many successors as there are
+   r-sets in colex order below {n-1-c_{r-1} < ... < n-1-c_0}. */
+uint
+edge_rank(Complete_graph * K, vertex * edge) {
+	ulong succ = 0;
+	uint j;
 
-	for (edge1 = K->edges, i = 0; i < K->m; edge1 += K->r, i++) {
-		if (!memcmp(edge1, edge2, K->edge_len))
-			return i;
-	}
-	return -1;
+	for (j = 0; j < K->r; j++)
+		succ += K->binom[(K->n - 1 - edge[j]) * (K->r + 1) + K->r - j];
+
+	return K->m - 1 - succ;
 }
 
-static vertex *
-invert_edge(vertex * edge, vertex n, uint r) {
-	vertex *ret;
-	uint i, j;
+/* The r-set with index i in K */
+vertex *
+edge_unrank(Complete_graph * K, uint i) {
+	return K->edges + i * K->r;
+}
 
-	ret = g_malloc((n - r) * sizeof(vertex));
+/* Vertices of K_n not in edge, in increasing order */
+static void
+invert_edge(vertex * edge, vertex n, uint r, vertex * ret) {
+	uint i, j;
 
 	for (j = i = 0; i < n; i++) {
 		/* vertex_is_in_edge expects vertex in range [1, n] */
@@ -243,56 +414,98 @@ invert_edge(vertex * edge, vertex n, uint r) {
 			ret[j++] = i;
 		}
 	}
-	return ret;
+}
+
+/* The K->m - m edges of K not set in bits, in increasing order */
+static void
+complement_edges(ulong * bits, Complete_graph * K, uint * edges) {
+	ulong w;
+	uint i, j;
+
+	for (j = i = 0; i < K->words; i++) {
+		w = ~bits[i];
+		if (i == K->words - 1 && K->m % WORD_BITS)
+			w &= ((ulong)1 << (K->m % WORD_BITS)) - 1;
+		for (; w; w &= w - 1)
+			edges[j++] = i * WORD_BITS + __builtin_ctzll(w);
+	}
 }
 
 Graph *
 complement(Graph * g, Complete_graph * K) {
 	Graph *ret = NULL;
-	uint e, i;
+
+	set_bits(g, K);
 
 	ret = Galloc(K->n, K->m - g->m);
-	for (e = i = 0; e < K->m; e++) {
-		if (!edge_is_in_graph(e, g))
-			ret->edges[i++] = e;
+	complement_edges(g->bits, K, ret->edges);
+
+	return ret;
+}
+
+GraphBatch *
+batch_complement(GraphBatch * B, Complete_graph * K) {
+	GraphBatch *ret;
+	ulong *bits;
+	uint i, j, *edges;
+
+	ret = batch_alloc(K->m - B->m, B->n);
+	bits = Balloc(K);
+	for (i = 0; i < B->n; i++) {
+		edges = BATCH_EDGES(B, i);
+		for (j = 0; j < B->m; j++)
+			BIT_SET(bits, edges[j]);
+		complement_edges(bits, K, batch_add(ret));
+		for (j = 0; j < B->m; j++)
+			BIT_CLR(bits, edges[j]);
 	}
+	free(bits);
 
 	return ret;
 }
 
 Graph *
 covering_design(Graph * g, Complete_graph * Kg, Complete_graph * Kd) {
-	uint *g_complement;
-	uint e, i, gci, gi;
+	Graph *g_complement;
+	uint i;
 	Graph *ret;
-	uint blocks;
-	int block_i;
-	vertex *edge;
-	vertex *block;
+	vertex block[UINT8_MAX];
 
-	blocks = Kg->m - g->m;
+	if (Kd->n != Kg->n || Kd->r != (uint) Kg->n - Kg->r)
+		return NULL;
 
-	ret = Galloc(Kg->n, blocks);
-	g_complement = g_malloc(blocks * sizeof(uint));
-	for (gci = gi = e = 0; e < Kg->m; e++) {
-		if (!edge_is_in_graph(e, g))
-			g_complement[gci++] = e;
+	g_complement = complement(g, Kg);
 
+	ret = Galloc(Kg->n, g_complement->m);
+
+	for (i = 0; i < g_complement->m; i++) {
+		invert_edge(edge_unrank(Kg, g_complement->edges[i]), Kg->n, Kg->r, block);
+		ret->edges[i] = edge_rank(Kd, block);
 	}
 
-	for (i = 0; i < blocks; i++) {
-		edge = Kg->edges + Kg->r * g_complement[i];
-		block = invert_edge(edge, Kg->n, Kg->r);
+	free_G(g_complement);
+	return ret;
+}
+
+GraphBatch *
+batch_covering_design(GraphBatch * B, Complete_graph * Kg, Complete_graph * Kd) {
+	GraphBatch *ret;
+	uint i, j, *edges;
+	vertex block[UINT8_MAX];
 
-		if ((block_i = edge_index(Kd, block)) == -1) {
-			return NULL;
-		} else {
-			ret->edges[i] = block_i;
+	if (Kd->n != Kg->n || Kd->r != (uint) Kg->n - Kg->r)
+		return NULL;
+
+	/* the blocks are the complements of the edges not in the graph */
+	ret = batch_complement(B, Kg);
+	for (i = 0; i < ret->n; i++) {
+		edges = BATCH_EDGES(ret, i);
+		for (j = 0; j < ret->m; j++) {
+			invert_edge(edge_unrank(Kg, edges[j]), Kg->n, Kg->r, block);
+			edges[j] = edge_rank(Kd, block);
 		}
-		free(block);
 	}
 
-	free(g_complement);
 	return ret;
 }
 
@@ -311,16 +524,13 @@ cleanup(Graph * head) {
 
 }
 
-void
-set_s6(Graph * g, Complete_graph * K) {
-	uint n, byte, i, j, k, l, vs = 0, carrybits = 0;
-	ulong y = 0, carry = 0;
-	int nbits;
-	size_t len;
-	vertex *edge;
+/* Bytes of the sparse6 string of graphs on m edges, with the '\0' */
+static size_t
+s6_len(uint m, Complete_graph * K) {
+	uint n, i, k;
 
 	/* number of vertices in Levi graph */
-	n = K->n + g->m;
+	n = K->n + m;
 
 	/* number of bits needed to represent n-1 */
 	k = 0;
@@ -328,35 +538,48 @@ set_s6(Graph * g, Complete_graph * K) {
 		k++;
 
 	/* number of bytes needed for s6-representation of graph */
-	len = 2			/* first byte: ':' + last byte: '\0' */
+	return 2			/* first byte: ':' + last byte: '\0' */
 	 + (n < 63 ? 1 : 4)	/* representation of n */
 	 +(k + 1) / 6.0		/* k+1 bits per "information-unit", 6 bits per byte */
 	 * (n			/* one "movement" per vertex */
-	    + K->r * g->m	/* edges */
-	    + (((uint) K->n == g->m)	/* qlique of vertices */
+	    + K->r * m		/* edges */
+	    + (((uint) K->n == m)	/* qlique of vertices */
 	       ? (K->n - 1) * K->n / 2 : 0)
 	    /*+ 1  just in case */
 	 );
+}
 
-	g->s6 = g_malloc(len * sizeof(char));
-	g->s6[0] = ':';
-	g->s6[len - 1] = 0;
+/* Write the sparse6 string of g to s6, which has room for len bytes */
+static void
+s6_encode(Graph * g, Complete_graph * K, char *s6, size_t len) {
+	uint n, byte, i, j, k, l, vs = 0, carrybits = 0;
+	ulong y = 0, carry = 0;
+	int nbits;
+	vertex *edge;
+
+	n = K->n + g->m;
+	k = 0;
+	for (i = n - 1; i; i = i >> 1)
+		k++;
+
+	s6[0] = ':';
+	s6[len - 1] = 0;
 
 	if (n < 63) {
-		g->s6[1] = 63 + n;
+		s6[1] = 63 + n;
 		byte = 2;
 	} else {
 		byte = 1;
-		g->s6[byte++] = 126;
-		g->s6[byte++] = 63 + (n >> 12);
-		g->s6[byte++] = 63 + ((n >> 6) & 63);
-		g->s6[byte++] = 63 + (n & 63);
+		s6[byte++] = 126;
+		s6[byte++] = 63 + (n >> 12);
+		s6[byte++] = 63 + ((n >> 6) & 63);
+		s6[byte++] = 63 + (n & 63);
 	}
 
 #define SETBITS(BITS_X) \
 	y = (carry << (k + 1)) /* "b" == 0 */ | (BITS_X); \
 	for(nbits = carrybits + k - 5; nbits >= 0; nbits -= 6) \
-		g->s6[byte++] = 63 + ((y  >> (nbits)) & 63); \
+		s6[byte++] = 63 + ((y  >> (nbits)) & 63); \
 	carrybits = nbits + 6; \
 	carry = y & ((1 << carrybits) - 1); \
 
@@ -391,138 +614,244 @@ set_s6(Graph * g, Complete_graph * K) {
 
 	if (carrybits) {	/* paddningsvilkor enligt ntos6() i gtools.c */
 		if (6 - carrybits > k && vs == n - 2 && n == (uint) 1 << k)
-			g->s6[byte++] = ((carry << (6 - carrybits)) | ((uint) 63 >> (carrybits + 1))) + 63;
+			s6[byte++] = ((carry << (6 - carrybits)) | ((uint) 63 >> (carrybits + 1))) + 63;
 		else
-			g->s6[byte++] = ((carry << (6 - carrybits)) | ((uint) 63 >> carrybits)) + 63;
+			s6[byte++] = ((carry << (6 - carrybits)) | ((uint) 63 >> carrybits)) + 63;
 	}
 
 	for ( /*sic! */ ; byte < len; byte++)
-		g->s6[byte] = 0;
+		s6[byte] = 0;
 
 }
 
-/* Remove superfluous graphs from linked list */
-Graph *
-isoreduce(Graph * head, Complete_graph * K) {
-	Graph *tmp, *newhead = NULL;
-	int i, j, out = 0, in = 0;
-	unsigned char *keep;
-	char *buf = NULL, *c;
-	int w_pipe[2] = { -1, -1 }, r_pipe[2] = {
-	-1, -1};
-	pid_t pid;
-	FILE *w_fp, *r_fp;
-	Graph **glist;
-	int status = 0;
+void
+set_s6(Graph * g, Complete_graph * K) {
+	size_t len;
 
-	if (!head)
-		return NULL;
+	len = s6_len(g->m, K);
+	g->s6 = g_malloc(len * sizeof(char));
+	s6_encode(g, K, g->s6, len);
+}
 
-	if (pipe(r_pipe) == -1 || pipe(w_pipe) == -1) {
-		errmsg("FATAL: pipe(): %s\n", strerror(errno));
-		exit(EXIT_FAILURE);
+/* Sparse6 strings of all graphs of B, in one allocation, since all
+   graphs on the same number of edges have strings of the same length */
+void
+batch_set_s6(GraphBatch * B, Complete_graph * K) {
+	Graph g;
+	size_t len;
+	uint i;
+
+	len = s6_len(B->m, K);
+	free(B->s6);
+	B->s6 = g_malloc((B->n ? B->n : 1) * len * sizeof(char));
+	B->s6_len = len;
+	for (i = 0; i < B->n; i++) {
+		batch_graph(B, i, &g);
+		s6_encode(&g, K, BATCH_S6(B, i), len);
 	}
+}
 
-	if ((pid = fork()) == -1) {
-		errmsg("FATAL: fork(): %s\n", strerror(errno));
-		exit(EXIT_FAILURE);
-	} else if (pid == 0) {	/* child, run nauty */
-		close(w_pipe[1]);
-		close(r_pipe[0]);
+/* splitmix64 finalizer */
+ulong
+mix64(ulong x) {
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
 
-		if (0 > dup2(w_pipe[0], STDIN_FILENO)
-		    || 0 > dup2(r_pipe[1], STDERR_FILENO))
-			/* sic!, the information we want is written to stderr by nauty */
-		{
-			errmsg("FATAL: dup2(): %s\n", strerror(errno));
-			exit(EXIT_FAILURE);
-		}
-		close(w_pipe[0]);
-		close(r_pipe[1]);
+/* Hash of the degree and pair co-degree profiles of g, equal for
+   isomorphic graphs.  Each vertex gets the hash of its degree and
+   of the multiset of its co-degrees with every other vertex, and
+   the graph the hash of the multiset of vertex hashes.  Multisets
+   are hashed as sums of mixed elements, independent of order. */
+ulong
+invariant_hash(Graph * g, Complete_graph * K) {
+	uint *codeg, *deg, i, j, l;
+	vertex *edge;
+	ulong h, sig;
 
-		if (execlp(SHORTG_BIN, SHORTG_BIN, "-quvk", (char *)NULL) == -1) {
-			errmsg("FATAL: execlp " SHORTG_BIN " -quvk: %s", strerror(errno));
-			exit(EXIT_FAILURE);
-		}
-		exit(EXIT_SUCCESS);
-	} else {		/* parent */
-		close(w_pipe[0]);
-		close(r_pipe[1]);
-
-		if (!(w_fp = fdopen(w_pipe[1], "w"))) {
-			errmsg("FATAL: fdopen nauty input: %s\n", strerror(errno));
-			exit(EXIT_FAILURE);
+	deg = g_calloc(K->n, sizeof(uint));
+	codeg = g_calloc(K->n * K->n, sizeof(uint));
+
+	for (i = 0; i < g->m; i++) {
+		edge = edge_unrank(K, g->edges[i]);
+		for (j = 0; j < K->r; j++) {
+			deg[edge[j]]++;
+			for (l = j + 1; l < K->r; l++) {
+				codeg[edge[j] * K->n + edge[l]]++;
+				codeg[edge[l] * K->n + edge[j]]++;
+			}
 		}
+	}
 
-		/* write s6 to nauty */
-		for (tmp = head; tmp; tmp = tmp->next) {
-			set_s6(tmp, K);
+	h = mix64(g->m);
+	for (i = 0; i < K->n; i++) {
+		sig = mix64(deg[i]);
+		for (j = 0; j < K->n; j++)
+			if (j != i)
+				sig += mix64(codeg[i * K->n + j] + ((ulong)1 << 32));
+		h += mix64(sig);
+	}
 
-			fputs(tmp->s6, w_fp);
-			fputc('\n', w_fp);
+	free(codeg);
+	free(deg);
 
-			free(tmp->s6);
+	return h;
+}
 
-			out++;
-		}
-		fclose(w_fp);
+typedef struct {
+	Complete_graph *K;
+	Graph **byno;		/* input graphs in input order */
+	ulong *inv;		/* invariant of each graph */
+	uint *order;		/* graph numbers sorted by invariant */
+	uint *bucket;		/* buckets are order[bucket[i]] ... order[bucket[i + 1] - 1] */
+	unsigned char *keep;
+} shards_t;
 
-		/* Nauty will give us a list of indices of the first graph in 
-		   any isomorphism class. Indices are with regards to the order
-		   in which the graph appear in the output we just wrote,
-		   they are in the range [1, number of graphs] */
+static shards_t *sort_shards;	/* for cmp_shard(), qsort has no context */
 
-		glist = g_malloc(out * sizeof(Graph *));
-		keep = g_calloc(out, sizeof(unsigned char));
-		for (i = 0, tmp = head; tmp; tmp = tmp->next, i++) {
-			glist[i] = tmp;
-		}
-		assert(out == i);
+static int
+cmp_shard(const void *a, const void *b) {
+	uint x = *(const uint *)a, y = *(const uint *)b;
 
-		if (!(r_fp = fdopen(r_pipe[0], "r"))) {
-			errmsg("FATAL: fdopen nauty output: %s\n", strerror(errno));
-			exit(EXIT_FAILURE);
-		}
-		while (!feof(r_fp)) {
-			buf = read_line(r_fp);
-
-			if ((c = strchr(buf, ':'))) {
-				c++;
-				j = atoi(c) - 1;
-				if (j < 0 || j >= out) {
-					errmsg("CANTHAPPEN: j = %d from nauty output: %s\n", j, buf);
-					exit(EXIT_FAILURE);
-				}
-				keep[j] = 1;
-				in++;
-			}
-			free(buf);
+	if (sort_shards->inv[x] != sort_shards->inv[y])
+		return sort_shards->inv[x] < sort_shards->inv[y] ? -1 : 1;
+	return x < y ? -1 : x > y;
+}
 
-		}
-		fclose(r_fp);
-
-		newhead = NULL;
-		for (j = 0; j < out; j++) {
-			if (keep[j]) {
-				tmp = glist[j];
-				tmp->next = newhead;
-				newhead = tmp;
-			} else {
-				free_G(glist[j]);
-			}
-		}
+/* Keep first graph of every isomorphism class within one bucket,
+   a graph alone in its bucket is kept without canonical labelling */
+static void
+reduce_shard(void *arg, uint b) {
+	shards_t *P = arg;
+	Certset *S;
+	ulong *cert;
+	uint i, no;
+
+	if (P->bucket[b + 1] - P->bucket[b] == 1) {
+		P->keep[P->order[P->bucket[b]]] = 1;
+		return;
+	}
+
+	S = certset_new(P->K->words, 0);
+	for (i = P->bucket[b]; i < P->bucket[b + 1]; i++) {
+		no = P->order[i];
+		cert = canon_cert(P->byno[no], P->K, NULL);
+		P->keep[no] = certset_add(S, cert, P->byno[no], 1);
+		free(cert);
+	}
+	certset_free(S);
+}
+
+/* Set keep[i] for the first graph of every isomorphism class among
+   byno[0] ... byno[n - 1].  Graphs with different invariant_hash()
+   can not be isomorphic, so the graphs are split into buckets by
+   invariant, and the buckets are reduced independently on
+   nthreads() threads. */
+static void
+reduce_shards(Graph ** byno, uint n, Complete_graph * K, unsigned char *keep) {
+	shards_t P;
+	uint i, nbuckets;
+
+	P.K = K;
+	P.byno = byno;
+	P.inv = g_malloc(n * sizeof(ulong));
+	P.order = g_malloc(n * sizeof(uint));
+	P.bucket = g_malloc((n + 1) * sizeof(uint));
+	P.keep = keep;
+
+	for (i = 0; i < n; i++) {
+		P.inv[i] = invariant_hash(byno[i], K);
+		P.order[i] = i;
+		keep[i] = 0;
+	}
+
+	sort_shards = &P;
+	qsort(P.order, n, sizeof(uint), cmp_shard);
+	for (nbuckets = i = 0; i < n; i++)
+		if (i == 0 || P.inv[P.order[i]] != P.inv[P.order[i - 1]])
+			P.bucket[nbuckets++] = i;
+	P.bucket[nbuckets] = n;
+
+	parallel_for(nbuckets, reduce_shard, &P);
+
+	free(P.inv);
+	free(P.order);
+	free(P.bucket);
+}
+
+/* Remove superfluous graphs from linked list, keeping the
+   first graph of every isomorphism class */
+Graph *
+isoreduce(Graph * head, Complete_graph * K) {
+	Graph *tmp, *newhead = NULL, **byno;
+	unsigned char *keep;
+	uint i, out = 0;
+
+	if (!head)
+		return NULL;
 
-		free(keep);
-		free(glist);
+	for (tmp = head; tmp; tmp = tmp->next)
+		out++;
 
-		waitpid(pid, &status, 0);
-		if (0 != WEXITSTATUS(status)) {
-			errmsg("FATAL: exec shortg: %s\n", strerror(errno));
-			exit(EXIT_FAILURE);
+	byno = g_malloc(out * sizeof(Graph *));
+	keep = g_malloc(out * sizeof(unsigned char));
+	for (i = 0, tmp = head; tmp; tmp = tmp->next, i++)
+		byno[i] = tmp;
+
+	reduce_shards(byno, out, K, keep);
+
+	/* like the input, output list is in reverse order */
+	for (i = 0; i < out; i++) {
+		if (keep[i]) {
+			tmp = byno[i];
+			tmp->next = newhead;
+			newhead = tmp;
+		} else {
+			free_G(byno[i]);
 		}
+	}
+
+	free(byno);
+	free(keep);
+
+	return newhead;
+}
 
-		return newhead;
+/* Keep the first graph of every isomorphism class of B, in order */
+void
+batch_isoreduce(GraphBatch * B, Complete_graph * K) {
+	Graph *views, **byno;
+	unsigned char *keep;
+	uint i, out;
+
+	if (!B->n)
+		return;
+
+	views = g_malloc(B->n * sizeof(Graph));
+	byno = g_malloc(B->n * sizeof(Graph *));
+	keep = g_malloc(B->n * sizeof(unsigned char));
+	for (i = 0; i < B->n; i++) {
+		batch_graph(B, i, views + i);
+		byno[i] = views + i;
 	}
+
+	reduce_shards(byno, B->n, K, keep);
+
+	for (out = i = 0; i < B->n; i++)
+		if (keep[i]) {
+			if (out != i)
+				memcpy(BATCH_EDGES(B, out), BATCH_EDGES(B, i), B->m * sizeof(uint));
+			out++;
+		}
+	B->n = out;
+	free(B->s6);
+	B->s6 = NULL;
+
+	free(views);
+	free(byno);
+	free(keep);
 }
 
 /* Construct complete r-graph on n vertices,
@@ -532,7 +861,7 @@ complete_graph(vertex n, uint r) {
 	Complete_graph *K;
 	gsl_combination *comb;
 	vertex *e;
-	uint i, j;
+	uint i, j, *fill;
 
 	K = Kalloc(n, r);
 	comb = gsl_combination_calloc(n, r);
@@ -544,6 +873,17 @@ complete_graph(vertex n, uint r) {
 
 	gsl_combination_free(comb);
 
+	/* Every vertex is in C(n-1, r-1) edges, r * K->m in all */
+	K->inc_start = g_malloc((n + 1) * sizeof(uint));
+	K->inc = g_malloc((size_t)r * K->m * sizeof(uint) + 1);
+	for (i = 0; i <= n; i++)
+		K->inc_start[i] = n && r ? i * (uint)nCk(n - 1, r - 1) : 0;
+	fill = g_calloc(n + 1, sizeof(uint));
+	for (e = K->edges, i = 0; i < K->m; e += r, i++)
+		for (j = 0; j < r; j++)
+			K->inc[K->inc_start[e[j]] + fill[e[j]]++] = i;
+	free(fill);
+
 	return K;
 }
 
@@ -665,25 +1005,103 @@ read_graph_to_complement(Complete_graph * K, uint m, FILE * fp) {
 	return comp;
 }
 
-/* Return likned list of all non-isomorphic m-sized subgraphs of K */
-Graph *
+/* The graphs on one more edge than the graphs in level, one from each
+   isomorphism class, by canonical augmentation: from every parent g
+   only one edge e per orbit of Aut(g) is tried, and the child h = g + e
+   is kept only if e is in the same orbit of Aut(h) as the edge of h
+   that gets the largest index under canonical labelling of h.
+   Every class then has exactly one accepted parent and edge, so
+   level must hold exactly one graph from each class. */
+static GraphBatch *
+next_level(GraphBatch * level, Complete_graph * K) {
+	GraphBatch *next;
+	Graph g, h;
+	vertex lab[UINT8_MAX + 1], edge[UINT8_MAX + 1], x, *gens;
+	uint *orbit, *h_orbit, *he, ngens, e, f, i, j, l, n, rank, maxrank;
+	ulong *cert, *bits;
+
+	next = batch_alloc(level->m + 1, level->n);
+	orbit = g_malloc(K->m * sizeof(uint));
+	h_orbit = g_malloc(K->m * sizeof(uint));
+	bits = Balloc(K);
+
+	for (n = 0; n < level->n; n++) {
+		batch_graph(level, n, &g);
+		cert = canon_aut(&g, K, NULL, &gens, &ngens);
+		free(cert);
+		edge_orbits(gens, ngens, K, orbit);
+		free(gens);
+		for (i = 0; i < g.m; i++)
+			BIT_SET(bits, g.edges[i]);
+
+		for (e = 0; e < K->m; e++) {
+			if (BIT_ISSET(bits, e) || orbit[e] != e)
+				continue;
+
+			he = batch_add(next);
+			for (j = i = 0; i < g.m && g.edges[i] < e; i++)
+				he[j++] = g.edges[i];
+			he[j++] = e;
+			for (; i < g.m; i++)
+				he[j++] = g.edges[i];
+			batch_graph(next, next->n - 1, &h);
+
+			/* canonical deletion */
+			cert = canon_aut(&h, K, lab, &gens, &ngens);
+			free(cert);
+			maxrank = 0;
+			for (f = i = 0; i < h.m; i++) {
+				for (j = 0; j < K->r; j++) {
+					x = lab[edge_unrank(K, h.edges[i])[j]];
+					for (l = j; l > 0 && edge[l - 1] > x; l--)
+						edge[l] = edge[l - 1];
+					edge[l] = x;
+				}
+				if ((rank = edge_rank(K, edge)) >= maxrank) {
+					maxrank = rank;
+					f = h.edges[i];
+				}
+			}
+			edge_orbits(gens, ngens, K, h_orbit);
+			free(gens);
+
+			if (h_orbit[e] != h_orbit[f])
+				next->n--;
+		}
+
+		for (i = 0; i < g.m; i++)
+			BIT_CLR(bits, g.edges[i]);
+	}
+
+	free(bits);
+	free(h_orbit);
+	free(orbit);
+	return next;
+}
+
+/* Return all non-isomorphic m-sized subgraphs of K, built one edge
+   at a time from the empty graph, or from the complete graph if m
+   is more than half the edges of K */
+GraphBatch *
 subgraphs_on_m_edges(Complete_graph * K, uint m) {
-	Graph *tmp, *head = NULL;
-	uint i;
-	gsl_combination *comb;
+	GraphBatch *level, *next;
+	uint i, mm;
 
-	comb = gsl_combination_calloc(K->m, m);
+	mm = 2 * m > K->m ? K->m - m : m;
 
-	do {
-		tmp = Galloc(K->n, m);
-		for (i = 0; i < m; i++)
-			tmp->edges[i] = gsl_combination_get(comb, i);
-		tmp->next = head;
-		head = tmp;
+	level = batch_alloc(0, 1);
+	batch_add(level);
+	for (i = 0; i < mm; i++) {
+		next = next_level(level, K);
+		free_batch(level);
+		level = next;
 	}
-	while (GSL_SUCCESS == gsl_combination_next(comb));
 
-	gsl_combination_free(comb);
+	if (mm == m)
+		return level;
 
-	return isoreduce(head, K);
+	/* complements of the subgraphs on K->m - m edges */
+	next = batch_complement(level, K);
+	free_batch(level);
+	return next;
 }
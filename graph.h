@@ -32,7 +32,6 @@
 #include <stdio.h>
 #include <errno.h>
 #include <sys/types.h>
-#include <sys/wait.h>
 #include <gsl/gsl_combination.h>
 #include <gsl/gsl_sf_gamma.h>
 
@@ -40,6 +39,12 @@ typedef uint8_t vertex;
 typedef uint32_t uint;
 typedef uint64_t ulong;
 
+/* Packed edge sets, one bit per edge of the complete graph */
+#define WORD_BITS 64
+#define BITS_WORDS(m) (((m) + WORD_BITS - 1) / WORD_BITS)
+#define BIT_SET(b, i) ((b)[(i) / WORD_BITS] |= (ulong)1 << ((i) % WORD_BITS))
+#define BIT_CLR(b, i) ((b)[(i) / WORD_BITS] &= ~((ulong)1 << ((i) % WORD_BITS)))
+#define BIT_ISSET(b, i) (((b)[(i) / WORD_BITS] >> ((i) % WORD_BITS)) & 1)
 
 typedef struct Complete_graph Complete_graph;
 struct Complete_graph {
@@ -48,6 +53,10 @@ struct Complete_graph {
 	uint r;
 	vertex *edges;
 	size_t edge_len;
+	size_t words;		/* ulongs needed for a bitset of K->m edges */
+	ulong *binom;		/* binom[a * (r + 1) + b] = a choose b, a <= n, b <= r */
+	uint *inc;		/* the edges containing v are inc[inc_start[v]], ..., */
+	uint *inc_start;	/* inc[inc_start[v + 1] - 1], in increasing order */
 	Complete_graph *next;
 };
 
@@ -56,12 +65,41 @@ struct Graph {
 	uint *edges;
 	uint m;
 	char *s6;
+	ulong *bits;		/* optional edge set, see set_bits() */
 	Graph *next;
 };
 
-Graph *subgraphs_on_m_edges(Complete_graph*, uint);
+/* Graphs all on m edges, stored contiguously, see batch_graph() */
+typedef struct GraphBatch GraphBatch;
+struct GraphBatch {
+	uint n;
+	uint size;		/* room for this many graphs */
+	uint m;
+	uint *edges;		/* edges of graph i at BATCH_EDGES(B, i) */
+	char *s6;		/* see batch_set_s6() */
+	size_t s6_len;
+};
+
+#define BATCH_EDGES(B, i) ((B)->edges + (size_t)(i) * (B)->m)
+#define BATCH_S6(B, i) ((B)->s6 + (size_t)(i) * (B)->s6_len)
+
+GraphBatch *subgraphs_on_m_edges(Complete_graph*, uint);
+GraphBatch *batch_alloc(uint, uint);
+uint *batch_add(GraphBatch*);
+void batch_graph(GraphBatch*, uint, Graph*);
+void free_batch(GraphBatch*);
+GraphBatch *batch_complement(GraphBatch*, Complete_graph*);
+GraphBatch *batch_covering_design(GraphBatch*, Complete_graph*, Complete_graph*);
+void batch_set_s6(GraphBatch*, Complete_graph*);
+void batch_isoreduce(GraphBatch*, Complete_graph*);
 Graph *Galloc(vertex, uint);
 Graph *complement(Graph*, Complete_graph*);
+ulong *Balloc(Complete_graph*);
+void set_bits(Graph*, Complete_graph*);
+Graph *bits2graph(ulong*, uint, Complete_graph*);
+int edge_is_in_graph(uint, Graph*);
+uint edge_rank(Complete_graph*, vertex*);
+vertex *edge_unrank(Complete_graph*, uint);
 Complete_graph *Kalloc(vertex, uint);
 Complete_graph *complete_graph(vertex, uint);
 void free_G(Graph*);
@@ -69,12 +107,17 @@ void free_K(Complete_graph*);
 void cleanup(Graph*);
 void set_s6(Graph*, Complete_graph*);
 Graph *isoreduce(Graph*, Complete_graph*);
+int str2graph(Complete_graph*, Graph*, char*);
 Graph *read_graph(Complete_graph *, uint, FILE*);
 Graph *read_graph_to_complement(Complete_graph *, uint, FILE*);
 int vertex_is_in_edge(vertex, vertex*, uint);
+uint *edges_containing(Complete_graph*, vertex, uint*);
+uint edges_containing_set(Complete_graph*, vertex*, uint, uint*);
 uint *get_vertex_degrees(Graph*, Complete_graph*);
 uint Delta(Graph*, Complete_graph*);
 uint delta(Graph*, Complete_graph*);
+ulong mix64(ulong);
+ulong invariant_hash(Graph*, Complete_graph*);
 Graph *covering_design(Graph*,Complete_graph*,Complete_graph*);
 
 void printgs(Graph*, Complete_graph*);
@@ -86,6 +129,9 @@ void writeg_ei(Graph*, FILE*);
 void printg_ei(Graph*);
 void writegs_ei(Graph*, FILE*);
 void printgs_ei(Graph*);
+void writebatch_ei(GraphBatch*, FILE*);
+void writebatch(GraphBatch*, Complete_graph*, FILE*);
+void writebatch_s6(GraphBatch*, FILE*);
 
 uint nCk(uint, uint);
 
@@ -0,0 +1,429 @@
+/*
+ * Copyright © 2011,2012,2013 Lars Lindqvist <lars.lindqvist at yandex.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Graph files are either text, one graph per line as written by
+   writeg_ei(), or binary.  A binary file is a header
+
+	magic	 8 bytes, GRAPHFILE_MAGIC
+	order	 uint, GRAPHFILE_ORDER in the byte order of the writer
+	version	 uint
+	r, k	 uint, uint
+	n, m	 uint, uint
+	words	 ulong, ulongs per record
+	count	 ulong, number of graphs, 0 if not known
+	reserved 2 ulongs
+
+   followed by one record per graph, the edge set of the graph packed
+   as by set_bits().  Since the header carries r, k, n and m the file
+   name does not have to, and since the records are of fixed width a
+   regular file is memory-mapped and read without parsing.
+
+   Text files always start with a digit, so the first byte of the
+   input tells the two formats apart, even on a pipe.
+ */
+
+#include <stddef.h>
+#include <ctype.h>
+#include <sys/mman.h>
+#include "graph.h"
+#include "util.h"
+#include "graphfile.h"
+
+#define GRAPHFILE_MAGIC "EIGRAPHS"
+#define GRAPHFILE_ORDER 0x01020304
+#define GRAPHFILE_VERSION 1
+
+typedef struct {
+	char magic[8];
+	uint order;
+	uint version;
+	uint r, k;
+	uint n, m;
+	ulong words;
+	ulong count;
+	ulong reserved[2];
+} header_t;
+
+struct Graphfile {
+	FILE *fp;
+	int binary;
+	int out;
+	header_t h;
+	ulong *map;		/* records of a mapped binary file */
+	size_t map_len;
+	ulong *rec;		/* record buffer when reading a stream */
+	char *buf;		/* text input buffer */
+	size_t size, len, pos;
+	int eof;
+	ulong *seen;		/* edges of the line being parsed */
+	ulong next;		/* records read or written */
+};
+
+Graphfile *
+graphfile_open_in() {
+	Graphfile *gf;
+	struct stat st;
+	int c;
+
+	gf = g_calloc(1, sizeof(Graphfile));
+	gf->fp = open_infile();
+
+	c = getc(gf->fp);
+	if (c == EOF || ungetc(c, gf->fp) == EOF || c != GRAPHFILE_MAGIC[0])
+		return gf;
+
+	gf->binary = 1;
+	if (fread(&gf->h, sizeof(header_t), 1, gf->fp) != 1
+	    || memcmp(gf->h.magic, GRAPHFILE_MAGIC, sizeof(gf->h.magic))) {
+		errmsg("ERROR: not a graph file\n");
+		exit(EXIT_FAILURE);
+	}
+	if (gf->h.order != GRAPHFILE_ORDER || gf->h.version != GRAPHFILE_VERSION) {
+		errmsg("ERROR: graph file of other byte order or version\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (fstat(fileno(gf->fp), &st) == 0 && S_ISREG(st.st_mode) && (size_t)st.st_size > sizeof(header_t)) {
+		gf->map_len = st.st_size;
+		gf->map = mmap(NULL, gf->map_len, PROT_READ, MAP_PRIVATE, fileno(gf->fp), 0);
+		if (gf->map == MAP_FAILED) {
+			gf->map = NULL;
+		} else {
+			posix_madvise(gf->map, gf->map_len, POSIX_MADV_SEQUENTIAL);
+			/* a file whose writer never got to fill in the count */
+			if (!gf->h.count)
+				gf->h.count = (gf->map_len - sizeof(header_t)) / (gf->h.words * sizeof(ulong));
+		}
+	}
+	if (!gf->map)
+		gf->rec = g_malloc(gf->h.words * sizeof(ulong));
+
+	return gf;
+}
+
+/* Write the header now, the count is filled in by graphfile_close()
+   if fp is seekable */
+Graphfile *
+graphfile_open_out(FILE * fp, int binary, Complete_graph * K, uint k, uint m) {
+	Graphfile *gf;
+	struct stat st;
+
+	if (binary && fstat(fileno(fp), &st) == 0 && S_ISREG(st.st_mode) && st.st_size) {
+		errmsg("ERROR: can not append to a binary graph file\n");
+		exit(EXIT_FAILURE);
+	}
+
+	gf = g_calloc(1, sizeof(Graphfile));
+	gf->fp = fp;
+	gf->binary = binary;
+	gf->out = 1;
+	if (!binary)
+		return gf;
+
+	memcpy(gf->h.magic, GRAPHFILE_MAGIC, sizeof(gf->h.magic));
+	gf->h.order = GRAPHFILE_ORDER;
+	gf->h.version = GRAPHFILE_VERSION;
+	gf->h.r = K->r;
+	gf->h.k = k;
+	gf->h.n = K->n;
+	gf->h.m = m;
+	gf->h.words = K->words;
+	if (fwrite(&gf->h, sizeof(header_t), 1, fp) != 1) {
+		errmsg("ERROR: fwrite: %s\n", strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	gf->rec = Balloc(K);
+
+	return gf;
+}
+
+/* Set r, k, n and m from the header of a binary file, returns 0 for
+   text files */
+int
+graphfile_params(Graphfile * gf, uint * r, uint * k, uint * n, uint * m) {
+	if (!gf->binary)
+		return 0;
+
+	*r = gf->h.r;
+	*k = gf->h.k;
+	*n = gf->h.n;
+	*m = gf->h.m;
+	return 1;
+}
+
+/* Text input is read in large blocks into one buffer that is reused
+   for every line, and edge indices are parsed straight out of it.
+   Duplicate edges are found with a bitset that is cleared again only
+   at the edges just set, so reading a graph allocates nothing. */
+#define TEXT_BUFSIZE (1 << 20)
+
+/* Next line of text input, without its newline, or NULL at the end */
+static char *
+next_line(Graphfile * gf, size_t * len) {
+	char *nl, *line;
+	size_t n;
+
+	for (;;) {
+		nl = memchr(gf->buf + gf->pos, '\n', gf->len - gf->pos);
+		if (nl || (gf->eof && gf->pos < gf->len)) {
+			line = gf->buf + gf->pos;
+			*len = (nl ? nl : gf->buf + gf->len) - line;
+			gf->pos += *len + (nl != NULL);
+			return line;
+		}
+		if (gf->eof)
+			return NULL;
+
+		/* keep the partial line, grow only for lines longer than buf */
+		memmove(gf->buf, gf->buf + gf->pos, gf->len - gf->pos);
+		gf->len -= gf->pos;
+		gf->pos = 0;
+		if (gf->len == gf->size) {
+			gf->size *= 2;
+			gf->buf = g_realloc(gf->buf, gf->size);
+		}
+		n = fread(gf->buf + gf->len, 1, gf->size - gf->len, gf->fp);
+		gf->len += n;
+		if (!n) {
+			if (ferror(gf->fp)) {
+				errmsg("ERROR: fread: %s\n", strerror(errno));
+				read_line_errno = EIO;
+				return NULL;
+			}
+			gf->eof = 1;
+		}
+	}
+}
+
+static int
+parse_graph(Graphfile * gf, Complete_graph * K, Graph * g, const char *p, const char *end) {
+	uint i, m, ei;
+	int ret = 0;
+
+	for (m = 0; p < end && ret == 0;) {
+		if (!isdigit(*p)) {
+			errmsg("ERROR: invalid symbol: '%c' (chr: %d) expected digit\n", *p, *p);
+			ret = -1;
+			break;
+		}
+		for (ei = 0; p < end && isdigit(*p) && ei < K->m; p++)
+			ei = 10 * ei + (*p - '0');
+		if (ei >= K->m) {
+			errmsg("ERROR: edge index to large: %u, there are only "
+			       "%u possible edges in %u-graphs on %u vertices\n", ei, K->m, K->r, K->n);
+			ret = -1;
+		} else if (m == g->m) {
+			errmsg("ERROR: too many edges, should have %u\n", g->m);
+			ret = -1;
+		} else if (BIT_ISSET(gf->seen, ei)) {
+			errmsg("ERROR: duplicate edge index: %u\n", ei);
+			ret = -1;
+		} else {
+			BIT_SET(gf->seen, ei);
+			g->edges[m++] = ei;
+		}
+		while (p < end && (*p == ' ' || *p == '\t'))
+			p++;
+	}
+	if (ret == 0 && m < g->m) {
+		errmsg("ERROR: too few edges, %u, should be %u\n", m, g->m);
+		ret = -1;
+	}
+
+	for (i = 0; i < m; i++)
+		BIT_CLR(gf->seen, g->edges[i]);
+	return ret;
+}
+
+/* Read the next graph into g, which must have room for g->m edges.
+   If g->bits is set it is kept up to date.  Returns 0 at the end of
+   input and on errors, with read_line_errno set for errors. */
+int
+graphfile_read_into(Graphfile * gf, Complete_graph * K, Graph * g) {
+	ulong *rec, last, w;
+	uint i, j, bits;
+	size_t len;
+	char *line;
+
+	read_line_errno = 0;
+
+	if (!gf->binary) {
+		if (!gf->buf) {
+			gf->size = TEXT_BUFSIZE;
+			gf->buf = g_malloc(gf->size);
+			gf->seen = Balloc(K);
+		}
+		/* blank lines, such as a trailing one, are skipped */
+		do {
+			if (!(line = next_line(gf, &len)))
+				return 0;
+		} while (len == 0);
+		if (parse_graph(gf, K, g, line, line + len) == -1) {
+			errmsg("ERROR, corrupt graph near: %.*s\n", (int)(len < 64 ? len : 64), line);
+			read_line_errno = 1;
+			return 0;
+		}
+		if (g->bits) {
+			memset(g->bits, 0, K->words * sizeof(ulong));
+			for (i = 0; i < g->m; i++)
+				BIT_SET(g->bits, g->edges[i]);
+		}
+		return 1;
+	}
+
+	if (gf->h.n != K->n || gf->h.r != K->r || gf->h.m != g->m || gf->h.words != K->words) {
+		errmsg("ERROR: graph file has n=%u r=%u m=%u, expected n=%u r=%u m=%u\n",
+		       gf->h.n, gf->h.r, gf->h.m, K->n, K->r, g->m);
+		read_line_errno = EINVAL;
+		return 0;
+	}
+
+	if (gf->map) {
+		if (gf->next >= gf->h.count)
+			return 0;
+		rec = gf->map + sizeof(header_t) / sizeof(ulong) + gf->next * K->words;
+		if ((char *)(rec + K->words) > (char *)gf->map + gf->map_len) {
+			errmsg("ERROR: graph file is truncated\n");
+			read_line_errno = EINVAL;
+			return 0;
+		}
+	} else {
+		rec = gf->rec;
+		i = fread(rec, sizeof(ulong), K->words, gf->fp);
+		if (i != K->words) {
+			if (i) {
+				errmsg("ERROR: graph file is truncated\n");
+				read_line_errno = EINVAL;
+			}
+			return 0;
+		}
+	}
+	gf->next++;
+
+	last = K->m % WORD_BITS ? ~(ulong)0 << K->m % WORD_BITS : 0;
+	for (bits = i = 0; i < K->words; i++)
+		bits += __builtin_popcountll(rec[i]);
+	if (bits != g->m || (rec[K->words - 1] & last)) {
+		errmsg("ERROR, corrupt graph no. %lu\n", (unsigned long)gf->next);
+		read_line_errno = EINVAL;
+		return 0;
+	}
+
+	for (j = i = 0; i < K->words; i++)
+		for (w = rec[i]; w; w &= w - 1)
+			g->edges[j++] = i * WORD_BITS + __builtin_ctzll(w);
+	if (g->bits)
+		memcpy(g->bits, rec, K->words * sizeof(ulong));
+	return 1;
+}
+
+Graph *
+graphfile_read(Graphfile * gf, Complete_graph * K, uint m) {
+	Graph *g;
+
+	g = Galloc(K->n, m);
+	if (!graphfile_read_into(gf, K, g)) {
+		free_G(g);
+		return NULL;
+	}
+	return g;
+}
+
+/* Append up to max graphs to B, returns the number read */
+uint
+graphfile_read_batch(Graphfile * gf, Complete_graph * K, GraphBatch * B, uint max) {
+	Graph g;
+	uint i;
+
+	for (i = 0; i < max; i++) {
+		batch_add(B);
+		batch_graph(B, B->n - 1, &g);
+		if (!graphfile_read_into(gf, K, &g)) {
+			B->n--;
+			break;
+		}
+	}
+	return i;
+}
+
+void
+graphfile_write(Graphfile * gf, Graph * g, Complete_graph * K) {
+	uint i;
+
+	if (!gf->binary) {
+		writeg_ei(g, gf->fp);
+		return;
+	}
+
+	memset(gf->rec, 0, K->words * sizeof(ulong));
+	for (i = 0; i < g->m; i++)
+		BIT_SET(gf->rec, g->edges[i]);
+	if (fwrite(gf->rec, sizeof(ulong), K->words, gf->fp) != K->words) {
+		errmsg("ERROR: fwrite: %s\n", strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	gf->next++;
+}
+
+void
+graphfile_close(Graphfile * gf) {
+	if (gf->map)
+		munmap(gf->map, gf->map_len);
+
+	/* output to a pipe keeps count 0, readers then read to the end */
+	if (gf->binary && gf->out && fseek(gf->fp, offsetof(header_t, count), SEEK_SET) == 0) {
+		gf->h.count = gf->next;
+		fwrite(&gf->h.count, sizeof(ulong), 1, gf->fp);
+	}
+	f_close(gf->fp);
+	free(gf->rec);
+	free(gf->buf);
+	free(gf->seen);
+	free(gf);
+}
+
+/* Number of graphs in the file at path, from the header of a binary
+   file or the lines of a text file, 0 if it can't be read */
+ulong
+graphfile_count(const char *path) {
+	FILE *fp;
+	header_t h;
+	struct stat st;
+	ulong count = 0;
+	int c;
+
+	if (!(fp = fopen(path, "r")))
+		return 0;
+	if (fread(&h, sizeof(header_t), 1, fp) == 1 && !memcmp(h.magic, GRAPHFILE_MAGIC, sizeof(h.magic))) {
+		count = h.count;
+		if (!count && h.words && !fstat(fileno(fp), &st))
+			count = (st.st_size - sizeof(header_t)) / (h.words * sizeof(ulong));
+	} else {
+		rewind(fp);
+		while ((c = getc(fp)) != EOF)
+			if (c == '\n')
+				count++;
+	}
+	fclose(fp);
+
+	return count;
+}
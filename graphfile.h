@@ -0,0 +1,40 @@
+/*
+ * Copyright © 2011,2012,2013 Lars Lindqvist <lars.lindqvist at yandex.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef GRAPHFILE_H
+#define GRAPHFILE_H
+
+#include "graph.h"
+
+typedef struct Graphfile Graphfile;
+
+Graphfile *graphfile_open_in();
+Graphfile *graphfile_open_out(FILE*, int, Complete_graph*, uint, uint);
+int graphfile_params(Graphfile*, uint*, uint*, uint*, uint*);
+Graph *graphfile_read(Graphfile*, Complete_graph*, uint);
+int graphfile_read_into(Graphfile*, Complete_graph*, Graph*);
+uint graphfile_read_batch(Graphfile*, Complete_graph*, GraphBatch*, uint);
+void graphfile_write(Graphfile*, Graph*, Complete_graph*);
+void graphfile_close(Graphfile*);
+ulong graphfile_count(const char*);
+
+#endif
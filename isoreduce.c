@@ -22,11 +22,15 @@
 
 #include "util.h"
 #include "graph.h"
+#include "canon.h"
+#include "certset.h"
+#include "graphfile.h"
+#include <fcntl.h>
 
 static void
 usage(const char *prog) {
 	fprintf(stdout,
-		"usage: %s -r# -n# -m# [-q] [-o filename] [-a] [-C] [-D directory] [-f filename]\n"
+		"usage: %s -r# -n# -m# [-q] [-o filename] [-a [-I store]] [-C] [-d] [-D directory] [-f filename] [-B#] [-t#] [-b]\n"
 		"	semi-mandatory arguments\n"
 		"	 -r = graph uniformity\n"
 		"	 -k = vertices in forbidden graph\n"
@@ -37,10 +41,21 @@ usage(const char *prog) {
 		"	 -o, write output to file, use `-' for stdout\n"
 		"	 -f, graphs are read from given file, rather than stdin\n"
 		"	 -C, don't clobber output file\n"
+		"	 -d, double coverings, the default output filename is\n"
+		"	     `graphs-double-r=#-k=#-n=#-m=#.ei'\n"
 		"	 -q, quiet, surppress misc output\n"
+		"	 -B, memory limit in MiB for the set of seen graphs, beyond which\n"
+		"	     it is spilled to temporary files in the output directory\n"
+		"	 -t, number of threads for canonical labelling, default one per cpu\n"
+		"	 -b, write a binary graph file, `graphs-r=#-k=#-n=#-m=#.eib'\n"
+		"	 -I, with -a, reduce the input against the graphs of earlier runs\n"
+		"	     with the same store, and append only the new ones.  The\n"
+		"	     classes are kept in the store, in memory while running,\n"
+		"	     so -B and -b can't be used with it\n"
 		"	input: list of edge indices with regards to K^r_n,\n"
 		"	       one graph per line\n"
 		"	       indicies in range [0, nCr - 1]\n"
+		"	       or a binary graph file\n"
 		"	output: list of edge indicies of the non-isomorphic input graphs\n"
 		"	misc: Output directory will be choosen by:\n"
 		"	      1) command line argument -D\n"
@@ -48,31 +63,331 @@ usage(const char *prog) {
 		"	      3) compile time definition OUTDIR=" OUTDIR "\n"
 		"	      Default output filename is `graphs-r=#-k=#-n=#-m=#.ei'\n"
 		"         If input filename contains `-r=#-k=#-n=#-m=#', then -r -k -n and -m\n"
-		"         can be omitted.\n", prog);
+		"         can be omitted, as they can for binary input files.\n", prog);
 
 	exit(EXIT_FAILURE);
 }
 
+/* Anonymous temporary file in the output directory, which is
+   more likely than /tmp to have room for large runs */
+static FILE *
+spill_file() {
+	char path[PATH_MAX];
+	int fd;
+	FILE *fp;
+
+	snprintf(path, PATH_MAX - 1, "%s/.isoreduce-XXXXXX", options->graph_dir);
+	if ((fd = mkstemp(path)) == -1) {
+		errmsg("FATAL: mkstemp: %s: %s\n", path, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	unlink(path);
+	if (!(fp = fdopen(fd, "w+"))) {
+		errmsg("FATAL: fdopen: %s\n", strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	return fp;
+}
+
+/* Graphs are read in batches.  A graph is a new class if no earlier
+   graph had the same invariant_hash(), and then it is not canonized at
+   all.  Only graphs whose invariant collides with an earlier one are
+   canonized, in parallel, together with the first graph seen with
+   that invariant if it has not been canonized already.  Graphs that
+   are labelled-identical to an earlier representative are dropped
+   without canonizing.  Sets are then updated in input order. */
+#define BATCH 4096
+
+#define INV_CANON (1 << 1)	/* representative of invariant is in S */
+
+enum { DROP, NEW, COLLIDES };
+
+typedef struct {
+	Complete_graph *K;
+	uint m;
+	Certset *S;		/* certificates of canonized classes */
+	Certset *I;		/* invariants, with first representative */
+	Certset *L;		/* labelled edge sets of representatives */
+	FILE **runs;
+	uint nruns;
+	Graphfile *out;
+	uint nclasses;
+
+	Graph *g[BATCH];	/* allocated once, read into for every batch */
+	ulong inv[BATCH];
+	unsigned char what[BATCH];
+	uint job[BATCH];	/* job number of colliding graphs */
+	uint n;
+
+	/* graphs to canonize */
+	Graph **job_g;
+	ulong **job_cert;
+	ulong *job_flag;	/* flags of representatives, see reps_from */
+	uint njobs;
+	uint maxjobs;
+	uint reps_from;		/* jobs from here are representatives of I */
+} reducer_t;
+
+static uint
+add_job(reducer_t * R, Graph * g, ulong flag) {
+	if (R->njobs == R->maxjobs) {
+		R->maxjobs = R->maxjobs ? 2 * R->maxjobs : BATCH;
+		R->job_g = g_realloc(R->job_g, R->maxjobs * sizeof(Graph *));
+		R->job_cert = g_realloc(R->job_cert, R->maxjobs * sizeof(ulong *));
+		R->job_flag = g_realloc(R->job_flag, R->maxjobs * sizeof(ulong));
+	}
+	R->job_g[R->njobs] = g;
+	R->job_flag[R->njobs] = flag;
+	return R->njobs++;
+}
+
+/* Schedule canonization of the representative of invariant j */
+static void
+add_rep_job(reducer_t * R, uint j) {
+	Graph *rep;
+
+	*certset_flag(R->I, j) |= INV_CANON;
+	rep = Galloc(R->K->n, R->m);
+	memcpy(rep->edges, certset_edges(R->I, j), R->m * sizeof(uint));
+	add_job(R, rep, *certset_flag(R->I, j) & CERTSET_WRITTEN);
+}
+
+static void
+hash_graph(void *arg, uint i) {
+	reducer_t *R = arg;
+
+	set_bits(R->g[i], R->K);
+	R->inv[i] = invariant_hash(R->g[i], R->K);
+}
+
+static void
+canonize(void *arg, uint i) {
+	reducer_t *R = arg;
+	Graph *comp;
+
+	/* canonize the complement, it usually has fewer edges */
+	comp = complement(R->job_g[i], R->K);
+	R->job_cert[i] = canon_cert(comp, R->K, NULL);
+	free_G(comp);
+}
+
+/* Canonize scheduled jobs and add the representatives among them to S */
+static void
+run_jobs(reducer_t * R) {
+	uint i;
+
+	parallel_for(R->njobs, canonize, R);
+	for (i = R->reps_from; i < R->njobs; i++) {
+		certset_add(R->S, R->job_cert[i], R->job_g[i], R->job_flag[i]);
+		free(R->job_cert[i]);
+		free_G(R->job_g[i]);
+	}
+}
+
+static void
+reduce_batch(reducer_t * R) {
+	uint i;
+	int j;
+
+	parallel_for(R->n, hash_graph, R);
+
+	/* colliding graphs of the batch are jobs [0, reps_from) */
+	R->njobs = 0;
+	for (i = 0; i < R->n; i++) {
+		if (certset_find(R->L, R->g[i]->bits) >= 0) {
+			R->what[i] = DROP;
+		} else if ((j = certset_find(R->I, R->inv + i)) < 0) {
+			R->what[i] = NEW;
+			certset_add(R->I, R->inv + i, R->g[i], R->nruns ? 0 : CERTSET_WRITTEN);
+			certset_add(R->L, R->g[i]->bits, NULL, 0);
+		} else {
+			R->what[i] = COLLIDES;
+			R->job[i] = add_job(R, R->g[i], 0);
+		}
+	}
+	R->reps_from = R->njobs;
+	for (i = 0; i < R->n; i++) {
+		if (R->what[i] != COLLIDES)
+			continue;
+		j = certset_find(R->I, R->inv + i);
+		if (!(*certset_flag(R->I, j) & INV_CANON))
+			add_rep_job(R, j);
+	}
+
+	run_jobs(R);
+
+	/* Until the first spill every new class is written as soon as it
+	   is seen.  After that a class might already be in a run on disk,
+	   so new classes are only written when merging the runs. */
+	for (i = 0; i < R->n; i++) {
+		if (R->what[i] == COLLIDES) {
+			if (certset_add(R->S, R->job_cert[R->job[i]], R->g[i], R->nruns ? 0 : CERTSET_WRITTEN))
+				certset_add(R->L, R->g[i]->bits, NULL, 0);
+			else
+				R->what[i] = DROP;
+			free(R->job_cert[R->job[i]]);
+		}
+		if (R->what[i] != DROP && !R->nruns) {
+			graphfile_write(R->out, R->g[i], R->K);
+			R->nclasses++;
+		}
+	}
+}
+
+/* Incremental reduction, -I.  The sets of the reducer are saved in the
+   store between runs, so that every run reduces only its own input,
+   against the classes of all earlier runs, and appends only the new
+   classes to the output.  Runs on the same output wait for each other
+   by locking it.  The store has the length of the output when it was
+   saved, and anything a run that died wrote after that is cut off. */
+#define STORE_MAGIC "EISTORE1"
+
+typedef struct {
+	char magic[8];
+	uint r, k, n, m;
+	ulong out_bytes;	/* of the output when the store was saved */
+	ulong nclasses;
+} store_t;
+
+static void
+lock_output(FILE * fp) {
+	struct flock fl;
+
+	memset(&fl, 0, sizeof(fl));
+	fl.l_type = F_WRLCK;
+	fl.l_whence = SEEK_SET;
+	if (fcntl(fileno(fp), F_SETLKW, &fl)) {
+		errmsg("FATAL: locking %s: %s\n", options->outfile, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void
+store_load(reducer_t * R, store_t * h, FILE * out_fp) {
+	store_t saved;
+	struct stat st;
+	FILE *fp;
+
+	if (fstat(fileno(out_fp), &st)) {
+		errmsg("FATAL: %s: %s\n", options->outfile, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if (!(fp = fopen(options->store, "r"))) {
+		if (errno != ENOENT) {
+			errmsg("FATAL: %s: %s\n", options->store, strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		if (st.st_size) {
+			errmsg("FATAL: %s has graphs but no store\n", options->outfile);
+			exit(EXIT_FAILURE);
+		}
+		return;
+	}
+
+	if (fread(&saved, sizeof(store_t), 1, fp) != 1 || memcmp(saved.magic, h->magic, sizeof(h->magic))
+	    || saved.r != h->r || saved.k != h->k || saved.n != h->n || saved.m != h->m
+	    || !certset_load(R->I, fp) || !certset_load(R->S, fp)) {
+		errmsg("FATAL: %s is not a store of these graphs\n", options->store);
+		exit(EXIT_FAILURE);
+	}
+	fclose(fp);
+	*h = saved;
+
+	if ((ulong)st.st_size < h->out_bytes) {
+		errmsg("FATAL: %s is shorter than when %s was saved\n", options->outfile, options->store);
+		exit(EXIT_FAILURE);
+	}
+	if ((ulong)st.st_size > h->out_bytes && ftruncate(fileno(out_fp), h->out_bytes)) {
+		errmsg("FATAL: ftruncate: %s: %s\n", options->outfile, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+}
+
+/* The output first, so the store never has classes it doesn't have */
+static void
+store_save(reducer_t * R, store_t * h, FILE * out_fp) {
+	char tmp[PATH_MAX];
+	struct stat st;
+	FILE *fp;
+
+	if (fflush(out_fp) || fsync(fileno(out_fp)) || fstat(fileno(out_fp), &st)) {
+		errmsg("FATAL: %s: %s\n", options->outfile, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	h->out_bytes = st.st_size;
+	h->nclasses += R->nclasses;
+
+	snprintf(tmp, PATH_MAX, "%s.tmp", options->store);
+	fp = f_open(tmp, "w");
+	if (fwrite(h, sizeof(store_t), 1, fp) != 1) {
+		errmsg("FATAL: writing %s: %s\n", tmp, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	certset_save(R->I, fp);
+	certset_save(R->S, fp);
+	if (fflush(fp) || fsync(fileno(fp)) || fclose(fp) || rename(tmp, options->store)) {
+		errmsg("FATAL: saving %s: %s\n", options->store, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+}
+
+static size_t
+reducer_bytes(reducer_t * R) {
+	return certset_bytes(R->S) + certset_bytes(R->I) + certset_bytes(R->L);
+}
+
+/* Canonize every representative not yet in S, and spill S */
+static void
+spill(reducer_t * R) {
+	uint j;
+
+	R->njobs = R->reps_from = 0;
+	for (j = 0; j < certset_count(R->I); j++)
+		if (!(*certset_flag(R->I, j) & INV_CANON))
+			add_rep_job(R, j);
+	run_jobs(R);
+
+	R->runs = g_realloc(R->runs, (R->nruns + 1) * sizeof(FILE *));
+	R->runs[R->nruns] = spill_file();
+	certset_spill(R->S, R->runs[R->nruns++]);
+	certset_clear(R->I);
+	certset_clear(R->L);
+}
+
 int
 main(int argc, char *argv[]) {
-	Graph *tmp, *comp, *comp_head = NULL;
 	Complete_graph *K;
-	FILE *in_fp, *out_fp;
-	uint r = 0, k = 0, m = 0, n = 0, ngraphs, dummy;
+	reducer_t *R;
+	store_t store;
+	Graphfile *in;
+	FILE *out_fp;
+	uint r = 0, k = 0, m = 0, n = 0, ngraphs, dummy, i;
+	size_t limit;
 	int error = 0;
+	long bytes;
+	struct stat st;
+	Runclock clock;
 
-	init(argc, argv, "qvr:k:n:m:o:aCD:f:");
+	init(argc, argv, "qvr:k:n:m:o:aCdD:f:B:t:bI:");
 
 	if (options->help)
 		usage(argv[0]);
-	if ((!(r = options->forbidden.r)
+	runclock_start(&clock);
+	if (options->store && (!options->append || options->mem_limit || options->binary)) {
+		errmsg("FATAL: -I appends to a text output, it needs -a and can't be used with -B or -b\n");
+		exit(EXIT_FAILURE);
+	}
+	in = graphfile_open_in();
+	if (!graphfile_params(in, &r, &k, &n, &m)
+	    && (!(r = options->forbidden.r)
 	     || !(k = options->forbidden.k)
 	     || !(n = options->n)
 	     || !(m = options->m))
 	    && (!options->infile || !parse_infile(&r, &k, &n, &m, &dummy, &dummy, PFN_r | PFN_k | PFN_n | PFN_m)))
 		usage(argv[0]);
 
-	out_fp = open_outfile("%s/graphs-r=%d-k=%d-n=%d-m=%d.ei", options->graph_dir, r, k, n, m);
+	out_fp = open_outfile("%s/graphs%s-r=%d-k=%d-n=%d-m=%d.%s", options->graph_dir,
+			      options->lambda == 2 ? "-double" : "", r, k, n, m, options->binary ? "eib" : "ei");
 	if (!out_fp) {		/* should only happen if output file exists and noclobber is set */
 		if (!options->quiet)
 			infomsg("NOTICE: No output file, exiting\n");
@@ -80,42 +395,94 @@ main(int argc, char *argv[]) {
 	}
 
 	K = complete_graph(n, r);
-
-	in_fp = open_infile();
+	R = g_calloc(1, sizeof(reducer_t));
+	R->K = K;
+	R->m = m;
+	R->S = certset_new(K->words, m);
+	R->I = certset_new(1, m);
+	R->L = certset_new(K->words, 0);
+	for (i = 0; i < BATCH; i++)
+		R->g[i] = Galloc(K->n, m);
+	if (options->store) {
+		if (out_fp == stdout) {
+			errmsg("FATAL: -I needs an output file\n");
+			exit(EXIT_FAILURE);
+		}
+		lock_output(out_fp);
+		memset(&store, 0, sizeof(store_t));
+		memcpy(store.magic, STORE_MAGIC, sizeof(store.magic));
+		store.r = r;
+		store.k = k;
+		store.n = n;
+		store.m = m;
+		store_load(R, &store, out_fp);
+	}
+	bytes = file_bytes(out_fp);
+	R->out = graphfile_open_out(out_fp, options->binary, K, k, m);
+	limit = (size_t)options->mem_limit << 20;
 
 	ngraphs = 0;
-	while (!feof(in_fp)) {
-		comp = read_graph_to_complement(K, m, in_fp);
-		if (!comp) {
-			error = read_line_errno;
-			break;
+	for (;;) {
+		for (R->n = 0; R->n < BATCH; R->n++) {
+			if (!graphfile_read_into(in, K, R->g[R->n])) {
+				error = read_line_errno;
+				break;
+			}
 		}
-		comp->next = comp_head;
-		comp_head = comp;
-		ngraphs++;
+		ngraphs += R->n;
+
+		reduce_batch(R);
+
+		if (limit && reducer_bytes(R) > limit) {
+			spill(R);
+			if (!options->quiet)
+				infomsg("Spilled run %u after %u graphs\n", R->nruns, ngraphs);
+		}
+
+		if (R->n < BATCH)
+			break;
 	}
-	f_close(in_fp);
+	graphfile_close(in);
 
 	if (!options->quiet)
 		infomsg("Read %u graphs\n", ngraphs);
 
-	comp_head = isoreduce(comp_head, K);
-
-	ngraphs = 0;
-	for (comp = comp_head; comp; comp = comp->next) {
-		/* write edge index of original graph, not the complement */
-		tmp = complement(comp, K);
-		assert(tmp);
-		writeg_ei(tmp, out_fp);
-		free_G(tmp);
-		ngraphs++;
+	if (R->nruns) {
+		spill(R);
+		R->nclasses += certset_merge(R->runs, R->nruns, K, m, R->out);
+		while (R->nruns)
+			fclose(R->runs[--R->nruns]);
+		free(R->runs);
 	}
+
 	if (!options->quiet)
-		infomsg("Found %u non-isomorphic graphs\n", ngraphs);
+		infomsg("Found %u non-isomorphic graphs\n", R->nclasses);
+
+	/* before the output is closed, which would drop the lock */
+	if (options->store) {
+		store_save(R, &store, out_fp);
+		if (!options->quiet)
+			infomsg("%lu graphs in %s\n", store.nclasses, options->outfile);
+	}
+
+	graphfile_close(R->out);
 
-	f_close(out_fp);
+	if (out_fp != stdout && !stat(options->outfile, &st))
+		bytes = st.st_size - bytes;
+	else
+		bytes = 0;
+	runlog("isoreduce", &clock, "\"N\": %u, \"M\": %u, \"graphs\": %u, \"classes\": %u, \"bytes\": %ld",
+	       n, m, ngraphs, R->nclasses, bytes);
 
+	free(R->job_g);
+	free(R->job_cert);
+	free(R->job_flag);
+	for (i = 0; i < BATCH; i++)
+		free_G(R->g[i]);
+	certset_free(R->S);
+	certset_free(R->I);
+	certset_free(R->L);
+	free(R);
 	free_K(K);
-	cleanup(comp_head);
 	return error;
 }
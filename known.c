@@ -0,0 +1,140 @@
+/*
+ * Copyright © 2011,2012,2013 Lars Lindqvist <lars.lindqvist at yandex.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Look up and record levels in the catalogue of the graph directory,
+   for the scripts, see catalog.c */
+
+#include "graph.h"
+#include "util.h"
+#include "catalog.h"
+#include <dirent.h>
+
+static void
+usage(const char *prog) {
+	fprintf(stdout,
+		"usage: %s -r# -k# [-d] [-n# -m#] [-a] [-f filename] [-q] [-D directory]\n"
+		"	mandatory arguments\n"
+		"	 -r, graph uniformity\n"
+		"	 -k, vertices in forbidden graph\n"
+		"	optional arguments\n"
+		"	 -d, double coverings, lambda = 2\n"
+		"	 -n, -m, the level of graphs on n vertices and m edges.  Exit\n"
+		"	     status 0 if it is complete, 2 if it has no graphs and 1\n"
+		"	     if it is not known.  Without them the levels of r and k\n"
+		"	     are listed\n"
+		"	 -a, with -n and -m, catalogue the level as complete, with the\n"
+		"	     graphs of -f, or as empty if there are none.  Without\n"
+		"	     them, catalogue the graph files of r and k and the\n"
+		"	     dontexist-N-M markers the directory already has, the\n"
+		"	     markers as of r, k and lambda\n"
+		"	 -f, graph file of the level, with a complete level it's\n"
+		"	     checked against the catalogue.  Default graphs-r=#-k=#-n=#-m=#.ei,\n"
+		"	     graphs-double-r=#-... with -d, in the graph directory\n"
+		"	 -q, quiet, only the exit status\n"
+		"	misc: Graph directory will be choosen by:\n"
+		"	      1) command line argument -D\n"
+		"	      2) environment variable $GRAPH_DIR\n"
+		"	      3) compile time definition OUTDIR=" OUTDIR "\n", prog);
+
+	exit(EXIT_FAILURE);
+}
+
+/* Catalogue what a directory from before the catalogue has */
+static void
+import(uint r, uint k, uint lambda) {
+	DIR *dir;
+	struct dirent *de;
+	char path[PATH_MAX];
+	const char *fmt;
+	uint fr, fk, n, m, levels = 0;
+
+	fmt = lambda == 2 ? "graphs-double-r=%u-k=%u-n=%u-m=%u.ei" : "graphs-r=%u-k=%u-n=%u-m=%u.ei";
+
+	if (!(dir = opendir(options->graph_dir))) {
+		errmsg("FATAL: %s: %s\n", options->graph_dir, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	while ((de = readdir(dir))) {
+		snprintf(path, PATH_MAX, "%s/%s", options->graph_dir, de->d_name);
+		if (sscanf(de->d_name, fmt, &fr, &fk, &n, &m) == 4 && fr == r && fk == k) {
+			if (catalog_lookup(r, k, lambda, n, m, NULL) != CAT_UNKNOWN)
+				continue;
+			catalog_record(r, k, lambda, n, m, path, "known");
+		} else if (sscanf(de->d_name, "dontexist-%u-%u", &n, &m) == 2) {
+			if (catalog_lookup(r, k, lambda, n, m, NULL) != CAT_UNKNOWN)
+				continue;
+			catalog_record(r, k, lambda, n, m, NULL, "known");
+		} else {
+			continue;
+		}
+		levels++;
+	}
+	closedir(dir);
+
+	if (!options->quiet)
+		infomsg("Catalogued %u levels\n", levels);
+}
+
+int
+main(int argc, char *argv[]) {
+	Catentry e;
+	char path[PATH_MAX];
+	uint r, k, n, m;
+	int status;
+
+	init(argc, argv, "qvr:k:n:m:daf:D:");
+
+	r = options->forbidden.r;
+	k = options->forbidden.k;
+	n = options->n;
+	m = options->m;
+	if (options->help || !r || !k || !n != !m)
+		usage(argv[0]);
+
+	if (!n) {
+		if (options->append)
+			import(r, k, options->lambda);
+		else
+			catalog_print(stdout, r, k, options->lambda);
+		return EXIT_SUCCESS;
+	}
+
+	if (options->infile)
+		snprintf(path, PATH_MAX, "%s", options->infile);
+	else
+		snprintf(path, PATH_MAX, "%s/graphs%s-r=%u-k=%u-n=%u-m=%u.ei", options->graph_dir,
+			 options->lambda == 2 ? "-double" : "", r, k, n, m);
+
+	if (options->append)
+		catalog_record(r, k, options->lambda, n, m, path, "known");
+
+	status = catalog_done(r, k, options->lambda, n, m, path);
+	if (options->infile && status == CAT_COMPLETE && catalog_lookup(r, k, options->lambda, n, m, &e) == CAT_COMPLETE
+	    && catalog_checksum(path) != e.checksum) {
+		errmsg("WARNING: %s does not have the checksum catalogued\n", path);
+		status = CAT_UNKNOWN;
+	}
+	if (!options->quiet)
+		fprintf(stdout, "N=%u M=%u %s\n", n, m, catalog_status(status));
+
+	return status == CAT_COMPLETE ? EXIT_SUCCESS : status == CAT_EMPTY ? 2 : EXIT_FAILURE;
+}
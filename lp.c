@@ -0,0 +1,392 @@
+/*
+ * Copyright © 2011,2012,2013 Lars Lindqvist <lars.lindqvist at yandex.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* The linear program for expanding a K^r_k-free r-graph g on n
+   vertices to the K^r_k-free r-graphs on N = n + 1 vertices and M
+   edges that contain g.  Variable x_i is 1 if edge i of K^r_N is in
+   the expanded graph.
+
+   The head rows are shared by every g: the edge count, and for every
+   k-set containing the new vertex N-1 at most C(k,r) - lambda of its
+   edges (lambda is 1, or 2 for double coverings).  The rows of g fix
+   the edges not containing the new vertex, and bound the degree of
+   the new vertex from below.
+
+   lphead and lpgraph write these rows as text that is concatenated
+   into one LP file, lpsolve can instead add them straight to a
+   model. */
+
+#include "graph.h"
+#include "util.h"
+#include "lp.h"
+#include "canon.h"
+
+/* Positions of the r-subsets of a k-set, in lexicographical order,
+   so that the edges of a sorted k-set come out ranked in increasing
+   order */
+static vertex *
+subset_positions(uint k, uint r) {
+	gsl_combination *sub;
+	vertex *subs;
+	uint i, j, nsubs = nCk(k, r);
+
+	subs = g_malloc(nsubs * r * sizeof(vertex) + 1);
+	if (!r)
+		return subs;
+	sub = gsl_combination_calloc(k, r);
+	for (i = 0; i < nsubs; i++) {
+		for (j = 0; j < r; j++)
+			subs[i * r + j] = gsl_combination_get(sub, j);
+		gsl_combination_next(sub);
+	}
+	gsl_combination_free(sub);
+
+	return subs;
+}
+
+/* Edge count and the rows excluding K^r_k */
+void
+lp_head_rows(Complete_graph * K_p, uint k, uint M, uint lambda, Lpsink * sink) {
+	gsl_combination *comb;
+	vertex *subs, *set, edge[UINT8_MAX];
+	uint *ind, i, j, l, r = K_p->r, N = K_p->n, nsubs;
+
+	ind = g_malloc(K_p->m * sizeof(uint));
+	for (i = 0; i < K_p->m; i++)
+		ind[i] = i;
+	sink->row(sink, K_p->m, ind, '=', M);
+
+	nsubs = nCk(k, r);
+	subs = subset_positions(k, r);
+
+	/* Only the k-subsets containing the new vertex N-1 are needed,
+	 * since all graphs should already have been verified to not
+	 * have the others as subgraphs.  These are the (k-1)-subsets of
+	 * the first N-1 vertices, with N-1 last. */
+	set = g_malloc(k * sizeof(vertex));
+	set[k - 1] = N - 1;
+	comb = gsl_combination_calloc(N - 1, k - 1);
+	do {
+		for (j = 0; j < k - 1; j++)
+			set[j] = gsl_combination_get(comb, j);
+
+		for (i = 0; i < nsubs; i++) {
+			for (l = 0; l < r; l++)
+				edge[l] = set[subs[i * r + l]];
+			ind[i] = edge_rank(K_p, edge);
+		}
+		sink->row(sink, nsubs, ind, '<', nsubs - lambda);
+	}
+	while (GSL_SUCCESS == gsl_combination_next(comb));
+
+	gsl_combination_free(comb);
+	free(subs);
+	free(set);
+	free(ind);
+}
+
+/* Rows of base graph g on the vertices of K, K_p is K plus one vertex.
+   Every old vertex v must end up with degree at least M - g->m, the
+   number of edges the new vertex gets, so the new vertex must share
+   at least M - g->m - deg(v) edges with v. */
+void
+lp_graph_rows(Graph * g, Complete_graph * K, Complete_graph * K_p, uint M, Lpsink * sink) {
+	uint *deg, *ind, j, e, nz;
+	vertex v, pair[2];
+
+	deg = get_vertex_degrees(g, K);
+	ind = g_malloc(K_p->m * sizeof(uint));
+
+	pair[1] = K->n;
+	for (v = 0; v < K->n; v++) {
+		pair[0] = v;
+		nz = edges_containing_set(K_p, pair, 2, ind);
+		sink->row(sink, nz, ind, '>', (int)(M - g->m) - (int)deg[v]);
+	}
+
+	/* The edges of K_p without the new vertex are the edges of K,
+	   in the same order, and are fixed to those of g.
+	   j = edge index wrt. K_n */
+	for (e = j = 0; j < K->m; j++) {
+		ind[0] = edge_rank(K_p, edge_unrank(K, j));
+		if (e < g->m && j == g->edges[e]) {
+			sink->row(sink, 1, ind, '=', 1);
+			e++;
+		} else {
+			sink->row(sink, 1, ind, '=', 0);
+		}
+	}
+
+	free(ind);
+	free(deg);
+}
+
+/* Rows of the k-sets T + {N-1}, with the edges of g substituted.
+   Every such k-set has the C(k-1,r) edges of T, fixed by g, and the
+   C(k-1,r-1) free edges through N-1.  A row that g leaves enough
+   slack for is dropped, and with zero slack its free edges are marked
+   in zero instead of emitting it, when sink is NULL. */
+static void
+clique_rows(ulong * bits, ulong * zero, Complete_graph * K_p, uint k, uint lambda, Lpsink * sink) {
+	gsl_combination *comb;
+	vertex *old, *new, *set, edge[UINT8_MAX];
+	uint *ind, i, l, r = K_p->r, N = K_p->n, nold, nnew, nz, f;
+	int slack;
+
+	nold = nCk(k - 1, r);
+	nnew = nCk(k - 1, r - 1);
+	old = subset_positions(k - 1, r);
+	new = subset_positions(k - 1, r - 1);
+	ind = g_malloc(nnew * sizeof(uint));
+	set = g_malloc(k * sizeof(vertex));
+
+	comb = gsl_combination_calloc(N - 1, k - 1);
+	do {
+		for (i = 0; i < k - 1; i++)
+			set[i] = gsl_combination_get(comb, i);
+
+		for (f = i = 0; i < nold; i++) {
+			for (l = 0; l < r; l++)
+				edge[l] = set[old[i * r + l]];
+			if (BIT_ISSET(bits, edge_rank(K_p, edge)))
+				f++;
+		}
+		slack = (int)nCk(k, r) - (int)lambda - (int)f;
+
+		edge[r - 1] = N - 1;
+		for (nz = i = 0; i < nnew; i++) {
+			for (l = 0; l < r - 1; l++)
+				edge[l] = set[new[i * (r - 1) + l]];
+			ind[nz] = edge_rank(K_p, edge);
+			if (!BIT_ISSET(zero, ind[nz]))
+				nz++;
+		}
+
+		if (slack >= (int)nz)
+			continue;
+		if (!sink) {
+			if (slack == 0)
+				for (i = 0; i < nz; i++)
+					BIT_SET(zero, ind[i]);
+		} else if (nz) {
+			sink->row(sink, nz, ind, '<', slack);
+		}
+	}
+	while (GSL_SUCCESS == gsl_combination_next(comb));
+
+	gsl_combination_free(comb);
+	free(set);
+	free(ind);
+	free(new);
+	free(old);
+}
+
+/* The rows of lp_head_rows() and lp_graph_rows() together, with the
+   edges fixed by g substituted into the other rows.  Rows that are
+   satisfied whatever the free edges are dropped, and the free edges
+   of rows without slack are fixed to 0, so only the edges through
+   the new vertex appear in rows other than x_i = 0/1.  The fixings
+   are kept, as variables are still named by their index in K_p. */
+void
+lp_reduced_rows(Graph * g, Complete_graph * K, Complete_graph * K_p, uint k, uint M, uint lambda, Lpsink * sink) {
+	ulong *bits, *zero;
+	uint *deg, *ind, *inc, *free_edges, nfree, len, nz, e, i;
+	vertex v, pair[2];
+	int rhs;
+
+	/* The edges of g, as edges of K_p */
+	bits = Balloc(K_p);
+	zero = Balloc(K_p);
+	for (e = 0; e < g->m; e++)
+		BIT_SET(bits, edge_rank(K_p, edge_unrank(K, g->edges[e])));
+
+	/* Zero slack is only possible if lambda is at least the number
+	   of free edges in a row, in which case the forced zeros must be
+	   known before any row is emitted */
+	if (nCk(k - 1, K_p->r - 1) <= lambda)
+		clique_rows(bits, zero, K_p, k, lambda, NULL);
+
+	ind = g_malloc(K_p->m * sizeof(uint));
+	free_edges = g_malloc(K_p->m * sizeof(uint));
+	inc = edges_containing(K_p, K->n, &len);
+	for (nfree = i = 0; i < len; i++)
+		if (!BIT_ISSET(zero, inc[i]))
+			free_edges[nfree++] = inc[i];
+
+	sink->row(sink, nfree, free_edges, '=', (int)M - (int)g->m);
+
+	clique_rows(bits, zero, K_p, k, lambda, sink);
+
+	deg = get_vertex_degrees(g, K);
+	pair[1] = K->n;
+	for (v = 0; v < K->n; v++) {
+		rhs = (int)(M - g->m) - (int)deg[v];
+		if (rhs <= 0)
+			continue;
+		pair[0] = v;
+		len = edges_containing_set(K_p, pair, 2, ind);
+		for (nz = i = 0; i < len; i++)
+			if (!BIT_ISSET(zero, ind[i]))
+				ind[nz++] = ind[i];
+		sink->row(sink, nz, ind, '>', rhs);
+	}
+
+	for (i = 0; i < K->m; i++) {
+		ind[0] = edge_rank(K_p, edge_unrank(K, i));
+		sink->row(sink, 1, ind, '=', BIT_ISSET(bits, ind[0]) ? 1 : 0);
+	}
+	for (i = 0; i < len; i++) {
+		ind[0] = inc[i];
+		if (BIT_ISSET(zero, ind[0]))
+			sink->row(sink, 1, ind, '=', 0);
+	}
+
+	free(deg);
+	free(free_edges);
+	free(ind);
+	free(zero);
+	free(bits);
+}
+
+/* Image of edge e of K_p under the vertex permutation gamma */
+static uint
+edge_image(Complete_graph * K_p, vertex * gamma, uint e) {
+	vertex edge[UINT8_MAX], x, *f;
+	uint j, l;
+
+	f = K_p->edges + (size_t)e * K_p->r;
+	for (j = 0; j < K_p->r; j++) {
+		x = gamma[f[j]];
+		for (l = j; l > 0 && edge[l - 1] > x; l--)
+			edge[l] = edge[l - 1];
+		edge[l] = x;
+	}
+	return edge_rank(K_p, edge);
+}
+
+/* Symmetry breaking for the expansions of g.  An automorphism of g,
+   fixing the new vertex, maps every expansion to an isomorphic one,
+   so it's enough to find those that are lexicographically largest
+   in their orbit, reading the edges through the new vertex in index
+   order.  Such an x has x_i >= x_j for every j in the orbit of the
+   first edge i that the group moves, and for every automorphism the
+   first edge i it moves has x_i >= x_j for j the image and preimage
+   of i.  These rows are added for the generators found by
+   canon_aut(), they keep at least one expansion of each class. */
+void
+lp_symmetry_rows(Graph * g, Complete_graph * K, Complete_graph * K_p, Lpsink * sink) {
+	vertex *gens, *gens_p, *gamma;
+	uint *inc, *orbit, *image, ngens, len, first, i, j, l;
+	ulong *cert;
+
+	cert = canon_aut(g, K, NULL, &gens, &ngens);
+	free(cert);
+	if (!ngens) {
+		free(gens);
+		return;
+	}
+
+	/* The generators on K_p, fixing the new vertex */
+	gens_p = g_malloc(ngens * K_p->n * sizeof(vertex));
+	for (l = 0; l < ngens; l++) {
+		memcpy(gens_p + l * K_p->n, gens + l * K->n, K->n);
+		gens_p[l * K_p->n + K->n] = K->n;
+	}
+
+	inc = edges_containing(K_p, K->n, &len);
+	orbit = g_malloc(K_p->m * sizeof(uint));
+	image = g_malloc(len * sizeof(uint) + 1);
+
+	/* Orbit of the first moved edge */
+	edge_orbits(gens_p, ngens, K_p, orbit);
+	for (first = K_p->m, i = 0; i < len; i++)
+		if (orbit[inc[i]] != inc[i] && orbit[inc[i]] < first)
+			first = orbit[inc[i]];
+	for (i = 0; i < len; i++)
+		if (inc[i] != first && orbit[inc[i]] == first)
+			sink->order(sink, first, inc[i]);
+
+	/* First moved edge of each generator */
+	for (gamma = gens_p, l = 0; l < ngens; l++, gamma += K_p->n) {
+		for (i = 0; i < len; i++)
+			image[i] = edge_image(K_p, gamma, inc[i]);
+		for (i = 0; i < len && image[i] == inc[i]; i++) ;
+		if (i == len || inc[i] == first)
+			continue;
+		sink->order(sink, inc[i], image[i]);
+		for (j = i + 1; j < len; j++)
+			if (image[j] == inc[i] && inc[j] != image[i])
+				sink->order(sink, inc[i], inc[j]);
+	}
+
+	free(image);
+	free(orbit);
+	free(gens_p);
+	free(gens);
+}
+
+static void
+text_row(Lpsink * sink, uint nz, uint * ind, char sense, int rhs) {
+	FILE *fp = sink->arg;
+	uint i;
+
+	for (i = 0; i < nz; i++)
+		fprintf(fp, i ? " + x%u" : " x%u", ind[i]);
+	fprintf(fp, " %s %d\n", sense == '=' ? "=" : sense == '<' ? "<=" : ">=", rhs);
+}
+
+static void
+text_order(Lpsink * sink, uint i, uint j) {
+	fprintf(sink->arg, " x%u - x%u >= 0\n", i, j);
+}
+
+/* Sink writing rows in LP file format */
+void
+lp_text_sink(Lpsink * sink, FILE * fp) {
+	sink->row = text_row;
+	sink->order = text_order;
+	sink->arg = fp;
+}
+
+/* Objective, before the rows */
+void
+lp_text_begin(Complete_graph * K_p, FILE * fp) {
+	uint i;
+
+	fputs("Maximize\n", fp);
+	for (i = 0; i < K_p->m - 1; i++)
+		fprintf(fp, " x%u +", i);
+	fprintf(fp, " x%u\n", i);
+	fputs("Subject to\n", fp);
+}
+
+/* Variable types, after the rows */
+void
+lp_text_end(Complete_graph * K_p, FILE * fp) {
+	uint i;
+
+	fputs("Binaries\n", fp);
+	for (i = 0; i < K_p->m - 1; i++)
+		fprintf(fp, " x%u", i);
+	fprintf(fp, " x%u\n", i);
+	fputs("End\n", fp);
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright © 2011,2012,2013 Lars Lindqvist <lars.lindqvist at yandex.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef LP_H
+#define LP_H
+
+#include "graph.h"
+
+/* Rows are handed to a sink, either written as LP text or added to a
+   solver's model.  All coefficients are 1, sense is one of '<', '='
+   and '>' (for <=, = and >=).  The symmetry breaking rows
+   x_i - x_j >= 0 go to order(sink, i, j). */
+typedef struct Lpsink Lpsink;
+struct Lpsink {
+	void (*row)(Lpsink*, uint, uint*, char, int);
+	void (*order)(Lpsink*, uint, uint);
+	void *arg;
+};
+
+void lp_head_rows(Complete_graph*, uint, uint, uint, Lpsink*);
+void lp_graph_rows(Graph*, Complete_graph*, Complete_graph*, uint, Lpsink*);
+void lp_reduced_rows(Graph*, Complete_graph*, Complete_graph*, uint, uint, uint, Lpsink*);
+void lp_symmetry_rows(Graph*, Complete_graph*, Complete_graph*, Lpsink*);
+
+void lp_text_sink(Lpsink*, FILE*);
+void lp_text_begin(Complete_graph*, FILE*);
+void lp_text_end(Complete_graph*, FILE*);
+
+#endif
@@ -21,18 +21,26 @@
  */
 
 #include "util.h"
+#include "graphfile.h"
+#include "lp.h"
 /* fixar minvalens */
 
 static void
 usage(const char *prog) {
 	fprintf(stdout,
-		"usage: %s <-M#> -r# -k# -n# -m# [-q] [-C] [-D directory] [-o filename] [-f filename]\n"
+		"usage: %s <-M#> -r# -k# -n# -m# [-R [-d]] [-y] [-q] [-C] [-D directory] [-o filename] [-f filename]\n"
 		"	semi-mandatory arguments\n"
 		"	 -r = graph uniformity\n"
 		"	 -k = vertices in forbidden graph\n"
 		"	 -n = vertices in input graphs\n"
 		"	 -m = edges in input graphs\n"
 		"	optional arguments\n"
+		"	 -R, write complete linear programs, with the edges of the input\n"
+		"	     graph substituted into the rows of lphead, rather than rows\n"
+		"	     to append to the output of lphead\n"
+		"	 -d, with -R, double coverings as with lphead-double\n"
+		"	 -y, add rows breaking the symmetries of the input graph, so\n"
+		"	     that fewer isomorphic expansions are found\n"
 		"    -D, output directory\n"
 		"	 -o, write output to file, use `-' for stdout\n"
 		"	 -f, graphs are read from given filename, rather than stdin\n"
@@ -48,92 +56,53 @@ usage(const char *prog) {
 		"	      Default output filenames are `lpgraph-r=#-k=#-n=#-m=#-N=#_no=#.lp'\n"
 		"	      where no=0, 1, 2, ... for the first, second, third, ... input graphs.\n"
 		"	      If input filename contains `-r=#-k=#-n=#-m=#', then -r -k -n and -m\n"
-		"	      can be omitted.\n", prog);
+		"	      can be omitted, as they can for binary input files.\n", prog);
 
 	exit(EXIT_FAILURE);
 }
 
-/* Write LP constraints of graph G, where x_i = 1 if the
-   i-th edge of K_p, the complete graph on n+1 vertices,
-   is in G, x_i = 0 if the i-th edge is not in G, and
-   x_i is not set if the edge contains the n+1st vertex
-   of K_p.
-   (i is in the range [0, n+1 choose r].)
- */
+/* Passes rows on to the text sink, counting them for the run log */
+typedef struct {
+	Lpsink text;
+	uint rows;
+} counter_t;
 
 static void
-write_lp(Graph * g, Complete_graph * K_p, FILE * fp) {
-	/* K_p = complete graph on n+1 vertices */
-	vertex *edge;
-	uint i, j = 0, edge_no = 0, isin;
-	unsigned char *new;
-
-	new = g_calloc(K_p->m, sizeof(unsigned char));
-
-	/* i = edge index wrt. K_{n+1} */
-	/* j = edge index wrt. K_n, as is stored in g->edges */
-	/* edge_no = current edge in g */
-
-	/* iterate over edges in K_{n+1} */
-	for (edge = K_p->edges, i = 0; i < K_p->m; i++, edge += K_p->r) {
-
-		if (vertex_is_in_edge(K_p->n, edge, K_p->r)) {
-			/* edges containing the "new" vertex should be free variables */
-			new[i] = 1;
-			continue;
-		}
-
-		if (edge_no < g->m && j == g->edges[edge_no]) {
-			isin = 1;
-			edge_no++;
-		} else
-			isin = 0;
-
-		fprintf(fp, " x%d = %d\n", i, isin);
-		j++;
-	}
+count_row(Lpsink * sink, uint nz, uint * ind, char sense, int rhs) {
+	counter_t *C = sink->arg;
 
-	free(new);
+	C->rows++;
+	C->text.row(&C->text, nz, ind, sense, rhs);
 }
 
 static void
-write_minval_lp(Graph * g, Complete_graph * K, Complete_graph * K_p, uint M, FILE * fp) {
-	uint Gp_delta = M - g->m;
-	uint *deg = get_vertex_degrees(g, K);
-	vertex v, *edge;
-	uint e, k;
-	uint x = nCk(K->n - 1, K_p->r - 2);
-
-	for (v = 0; v < K->n; v++) {
-		k = 0;
-		for (edge = K_p->edges, e = 0; e < K_p->m; e++, edge += K_p->r) {
-			if (vertex_is_in_edge(K_p->n, edge, K_p->r) && vertex_is_in_edge(v + 1, edge, K_p->r)) {
-				k++;
-				fprintf(fp, " x%d %c", e, k < x ? '+' : ' ');
-			}
-		}
-		fprintf(fp, ">= %d\n", Gp_delta - deg[v]);
-
-	}
-
-	free(deg);
+count_order(Lpsink * sink, uint i, uint j) {
+	counter_t *C = sink->arg;
 
+	C->rows++;
+	C->text.order(&C->text, i, j);
 }
 
 int
 main(int argc, char *argv[]) {
-	FILE *in_fp, *out_fp;
-	uint graph_no, i, n = 0, r = 0, k = 0, m = 0, M = 0, dummy = 0;
+	Graphfile *in;
+	FILE *out_fp;
+	uint graph_no, n = 0, r = 0, k = 0, m = 0, M = 0, dummy = 0;
 	Complete_graph *K_p, *K;
 	Graph *tmp;
+	Lpsink sink;
+	counter_t counter;
+	Runclock clock;
+	char *lp;
 	int error = 0;
 
-	init(argc, argv, "qvCr:k:n:m:o:f:D:M:");
+	init(argc, argv, "qvCr:k:n:m:o:f:D:M:Rdy");
 
 	if (options->help)
 		usage(argv[0]);
 
-	if (options->infile)
+	in = graphfile_open_in();
+	if (!graphfile_params(in, &r, &k, &n, &m) && options->infile)
 		parse_infile(&r, &k, &n, &m, &dummy, &dummy, PFN_r | PFN_k | PFN_n | PFN_m);
 	if (((!r && !(r = options->forbidden.r))
 	     || (!k && !(k = options->forbidden.k))
@@ -142,18 +111,17 @@ main(int argc, char *argv[]) {
 	     || (!m && !(m = options->m))))
 		usage(argv[0]);
 
-	in_fp = open_infile();
-
 	K = complete_graph(n, r);
 	K_p = complete_graph(n + 1, r);
 
 	graph_no = 0;
-	while (!feof(in_fp)) {
-		tmp = read_graph(K, m, in_fp);
-		if (!tmp) {
-			error = read_line_errno;
-			break;
-		}
+	sink.row = count_row;
+	sink.order = count_order;
+	sink.arg = &counter;
+
+	tmp = Galloc(K->n, m);
+	runclock_start(&clock);
+	while (graphfile_read_into(in, K, tmp)) {
 
 		out_fp = open_outfile("%s/lpgraph-r=%d-k=%d-n=%d-m=%d-N=%d-M=%d_no=%d.lp",
 				      options->graph_dir, r, k, n, m, n + 1, M, graph_no);
@@ -163,24 +131,34 @@ main(int argc, char *argv[]) {
 			continue;
 		}
 
-		write_minval_lp(tmp, K, K_p, M, out_fp);
-		write_lp(tmp, K_p, out_fp);
-		free_G(tmp);
-
-		fputs("Binaries\n", out_fp);
-		for (i = 0; i < K_p->m - 1; i++)
-			fprintf(out_fp, " x%d", i);
-		fprintf(out_fp, " x%d\n", i);
-		fputs("End\n", out_fp);
-
+		lp_text_sink(&counter.text, out_fp);
+		counter.rows = 0;
+		if (options->reduce) {
+			lp_text_begin(K_p, out_fp);
+			lp_reduced_rows(tmp, K, K_p, k, M, options->lambda, &sink);
+		} else {
+			lp_graph_rows(tmp, K, K_p, M, &sink);
+		}
+		if (options->symmetry)
+			lp_symmetry_rows(tmp, K, K_p, &sink);
+		lp_text_end(K_p, out_fp);
+
+		lp = json_escape(options->outfile);
+		runlog("lpgraph", &clock, "\"lp\": \"%s\", \"r\": %u, \"k\": %u, \"n\": %u, \"m\": %u, "
+		       "\"N\": %u, \"M\": %u, \"vars\": %u, \"rows\": %u, \"bytes\": %ld",
+		       lp, r, k, n, m, n + 1, M, K_p->m, counter.rows, file_bytes(out_fp));
+		free(lp);
 		graph_no++;
 
 		f_close(out_fp);
+		runclock_start(&clock);
 	}
+	error = read_line_errno;
+	free_G(tmp);
 
 	free_K(K);
 	free_K(K_p);
-	f_close(in_fp);
+	graphfile_close(in);
 
 	return error;
 }
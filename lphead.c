@@ -21,6 +21,7 @@
  */
 
 #include "util.h"
+#include "lp.h"
 
 static void
 usage(const char *prog) {
@@ -45,34 +46,12 @@ usage(const char *prog) {
 	exit(EXIT_FAILURE);
 }
 
-/* check if vertices in `edge' is a subset of vertices in `comb' */
-static unsigned char
-is_subset(vertex * edge, size_t * comb, uint r, uint k) {
-	uint i, j, match = 0;
-	for (i = 0; i < k; i++)
-		for (j = 0; j < r; j++)
-			if (comb[i] == edge[j])
-				if (++match == r)
-					return 1;
-	return 0;
-}
-
-static unsigned char
-vertex_is_in_K(vertex v, size_t * comb, uint k) {
-	uint i;
-	for (i = 0; i < k; i++)
-		if (comb[i] == v)
-			return 1;
-	return 0;
-}
-
 int
 main(int argc, char *argv[]) {
-	gsl_combination *comb;
 	Complete_graph *K;
+	Lpsink sink;
 	FILE *fp;
-	uint i, N, M, k, r, m, edgelimit, first;
-	vertex *edge;
+	uint N, M, k, r;
 
 	init(argc, argv, "qvr:k:N:M:o:CD:");
 
@@ -90,50 +69,11 @@ main(int argc, char *argv[]) {
 		return 0;
 	}
 
-	/* number of potential edges in r-graph in N vertices */
-	m = nCk(N, r);
-	edgelimit = nCk(k, r) - 1;
 	K = complete_graph(N, r);
 
-	fputs("Maximize\n", fp);
-	for (i = 0; i < m - 1; i++)
-		fprintf(fp, " x%d +", i);
-	fprintf(fp, " x%d\n", i);
-
-	fputs("Subject to\n", fp);
-
-	/* sum of edges */
-	for (i = 0; i < m - 1; i++)
-		fprintf(fp, " x%d +", i);
-	fprintf(fp, " x%d = %d\n", i, M);
-
-	/* foreach k-subset of vertices */
-	comb = gsl_combination_calloc(N, k);
-	do {
-
-		/* Skip complete graphs that does not contain the new vertex,
-		 * since all graphs should already have been verified to not
-		 * have these as subgraphs. */
-		if (!vertex_is_in_K(N - 1, comb->data, k))
-			continue;
-
-		/* foreach possible edge */
-		first = 1;
-		for (edge = K->edges, i = 0; i < K->m; i++, edge += K->r) {
-			if (is_subset(edge, comb->data, r, k)) {
-				if (first) {
-					fprintf(fp, " x%d", i);
-					first = 0;
-				} else {
-					fprintf(fp, " + x%d", i);
-				}
-			}
-		}
-		fprintf(fp, " <= %u\n", edgelimit);
-	}
-	while (GSL_SUCCESS == gsl_combination_next(comb));
-
-	gsl_combination_free(comb);
+	lp_text_begin(K, fp);
+	lp_text_sink(&sink, fp);
+	lp_head_rows(K, k, M, 1, &sink);
 
 	f_close(fp);
 
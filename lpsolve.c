@@ -23,6 +23,9 @@
 #include <math.h>
 #include "gurobi_c.h"
 #include "util.h"
+#include "graphfile.h"
+#include "lp.h"
+#include "certset.h"
 #include <sys/types.h>
 #include <time.h>
 #include <sys/resource.h>
@@ -32,117 +35,298 @@
 static void
 usage(const char *prog) {
 	fprintf(stdout,
-		"usage: %s -f filename [-T#] [-a] [-s#] [-S#] [-W#] [-p] [-D directory] [-q] [-t threads] [-C] [-o filename]\n"
+		"usage: %s -f filename [-T#] [-a] [-e] [-c# [-j#]] [-s#] [-S#] [-W#] [-p] [-D directory] [-q] [-t threads] [-C] [-o filename]\n"
+		"       %s -M# [-d] [-y] [-j#] [-r# -k# -n# -m#] -f graphs [options as above]\n"
 		"	mandatory arguments\n"
 		"    -f, linear program to solve\n"
+		"	 -M, expand the graphs in file to graphs on n+1 vertices and M edges,\n"
+		"	     building the linear program of each in memory, as lpgraph -R\n"
+		"	     would write it.  For every graph a line `Solved: file'\n"
+		"	     naming its solutions, or `Unfinished: file' naming the linear\n"
+		"	     program as it was when a limit was reached, is printed\n"
 		"   optional arguments\n"
+		"	 -d, double coverings, as with lphead-double\n"
+		"	 -y, with -M, break the symmetries of each graph, as lpgraph -y\n"
+		"	 -j, with -M, number of graphs to solve in parallel, each with\n"
+		"	     -t threads\n"
+		"	 -c, when a limit is hit, split the LP on # variables into\n"
+		"	     2^# cubes and solve them with -j workers, instead of\n"
+		"	     leaving it unfinished.  Cubes that hit a limit are split\n"
+		"	     again, idle workers take cubes from busy ones.  With -M,\n"
+		"	     at most -j models are solved at once in all\n"
 		"	 -t, number of threads for gurobi to use\n"
 		"	 -T, timelimit in minutes\n"
-		"	 -a, append solutions to output file\n"
-		"    -o, write output to file, use ``-'' for stdout\n"
+		"	 -a, append solutions to output file, and resume from it: the\n"
+		"	     solutions in it that the LP has no no-goods for are added\n"
+		"	     as no-goods.  The LP is only written when a limit is hit,\n"
+		"	     a run stopped by a signal is resumed this way\n"
+		"	 -e, enumerate all solutions in one search, rejecting each\n"
+		"	     with a lazy constraint instead of solving again\n"
+		"    -o, write output to file, use ``-'' for stdout, not with -M\n"
 		"	 -q, quiet, surppress misc output\n"
 		"	 -s, minimum numer of solutions before quiting due to exceeding time limit\n"
 		"	 -S, maximum numer of solutions, quit even if time limit has not been reached\n"
 		"	 -C, don't clobber output file\n"
-		"	 -W, write current state of LP back to file for every # solutions\n"
+		"	 -W, flush the output to disk every # solutions\n"
 		"	 -p, turn off presolve\n"
 		"	misc: Output directory will be choosen by:\n"
 		"	      1) command line argument -D\n"
 		"	      2) environment variable $GRAPH_DIR\n"
 		"	      3) compile time definition OUTDIR=" OUTDIR "\n"
-		"	      Default output filename is the input filename suffixed with ``.soln'' \n", prog);
+		"	      Default output filename is the input filename suffixed with ``.soln'',\n"
+		"	      with -M `solve-r=#-k=#-n=#-m=#-N=#-M=#_no=#.lp.soln'\n", prog, prog);
 
 	exit(EXIT_FAILURE);
 }
 
-static GRBenv *masterenv = NULL;
-static GRBmodel *model = NULL;
-static int n_vars;
+/* A model and the environment it was created in.  Gurobi environments
+   are not thread safe, so every worker of solve_graphs() has its own. */
+typedef struct {
+	GRBenv *env;
+	GRBmodel *model;
+	int n_vars;
+	double *ones;		/* coefficients of the rows of build_model() */
+	const char *path;	/* where save_state() writes the model */
+	uint nogoods;		/* rows of add_constraint(), the last of the model */
+	uint solutions;		/* written, for the run log */
+	Certset *found;		/* with cubes, every solution written, see conquer() */
+	ulong finder;		/* flag of the solutions this Lp adds to found */
+} Lp;
+
+/* Shared by the workers of solve_graphs() */
+typedef struct {
+	Graphfile *in;
+	Complete_graph *K, *K_p;
+	uint r, k, n, m, M;
+	uint graph_no;
+	int retval;
+	pthread_mutex_t lock;
+} batch_t;
 
 static void
-gurobi_err() {
-	if (masterenv)
-		errmsg("FATAL: gurobi: %s\n", GRBgeterrormsg(masterenv));
+gurobi_err(Lp * lp) {
+	if (lp->env)
+		errmsg("FATAL: gurobi: %s\n", GRBgeterrormsg(lp->env));
 	else
 		errmsg("FATAL: gurobi\n");
 
-	if (model)
-		GRBfreemodel(model);
-	if (masterenv)
-		GRBfreeenv(masterenv);
+	if (lp->model)
+		GRBfreemodel(lp->model);
+	if (lp->env)
+		GRBfreeenv(lp->env);
 
 	exit(EXIT_FAILURE);
 }
 
 static void
-init_gurobi(const char *path) {
+load_env(Lp * lp) {
 	int error;
-	GRBenv *env;
-
-	error = GRBloadenv(&masterenv, NULL);
-	if (error)
-		gurobi_err();
 
-	error = GRBsetintparam(masterenv, GRB_INT_PAR_OUTPUTFLAG, 0);
+	lp->model = NULL;
+	lp->ones = NULL;
+	lp->nogoods = 0;
+	lp->solutions = 0;
+	lp->found = NULL;
+	lp->finder = 0;
+	error = GRBloadenv(&lp->env, NULL);
 	if (error)
-		gurobi_err();
+		gurobi_err(lp);
 
-	error = GRBreadmodel(masterenv, path, &model);
+	error = GRBsetintparam(lp->env, GRB_INT_PAR_OUTPUTFLAG, 0);
 	if (error)
-		gurobi_err();
+		gurobi_err(lp);
+}
 
-	error = GRBgetintattr(model, GRB_INT_ATTR_NUMBINVARS, &n_vars);
-	if (error)
-		gurobi_err();
+/* Parameters of the model's own environment */
+static void
+set_params(Lp * lp) {
+	int error;
+	GRBenv *env;
 
-	env = GRBgetenv(model);
+	env = GRBgetenv(lp->model);
 	if (!env)
-		gurobi_err();
+		gurobi_err(lp);
 
 	if (options->threads) {
 		error = GRBsetintparam(env, GRB_INT_PAR_THREADS, options->threads);
 		if (error)
-			gurobi_err();
+			gurobi_err(lp);
 	}
 
 	if (!options->solutions_min && options->timelimit) {
 		error = GRBsetdblparam(env, GRB_DBL_PAR_TIMELIMIT, options->timelimit);
 		if (error)
-			gurobi_err();
+			gurobi_err(lp);
 	}
 	if (!options->presolve) {
 		error = GRBsetintparam(env, GRB_INT_PAR_PRESOLVE, 0);
 		if (error)
-			gurobi_err();
+			gurobi_err(lp);
 	}
 
 }
 
+/* The no-goods an earlier run saved with the model, they're named by
+   add_constraint() and are the last rows */
+static uint
+count_nogoods(Lp * lp) {
+	int rows, error;
+	char *name;
+	uint n = 0;
+
+	error = GRBgetintattr(lp->model, GRB_INT_ATTR_NUMCONSTRS, &rows);
+	if (error)
+		gurobi_err(lp);
+	while (rows > 0) {
+		error = GRBgetstrattrelement(lp->model, GRB_STR_ATTR_CONSTRNAME, --rows, &name);
+		if (error)
+			gurobi_err(lp);
+		if (strncmp(name, "nogood", 6))
+			break;
+		n++;
+	}
+
+	return n;
+}
+
 static int
-solve() {
+model_rows(Lp * lp) {
+	int rows, error;
+
+	error = GRBgetintattr(lp->model, GRB_INT_ATTR_NUMCONSTRS, &rows);
+	if (error)
+		gurobi_err(lp);
+	return rows;
+}
+
+static void
+init_gurobi(Lp * lp, const char *path) {
+	int error;
+
+	load_env(lp);
+	lp->path = path;
+
+	error = GRBreadmodel(lp->env, path, &lp->model);
+	if (error)
+		gurobi_err(lp);
+
+	error = GRBgetintattr(lp->model, GRB_INT_ATTR_NUMBINVARS, &lp->n_vars);
+	if (error)
+		gurobi_err(lp);
+	lp->nogoods = count_nogoods(lp);
+
+	set_params(lp);
+}
+
+static void
+grb_row(Lpsink * sink, uint nz, uint * ind, char sense, int rhs) {
+	Lp *lp = sink->arg;
+	int error;
+
+	/* Fixed variables become bounds */
+	if (nz == 1 && sense == '=') {
+		error = GRBsetdblattrelement(lp->model, rhs ? GRB_DBL_ATTR_LB : GRB_DBL_ATTR_UB, ind[0], rhs);
+		if (error)
+			gurobi_err(lp);
+		return;
+	}
+
+	/* Lpsink senses are GRB_LESS_EQUAL, GRB_EQUAL and GRB_GREATER_EQUAL */
+	error = GRBaddconstr(lp->model, nz, (int *)ind, lp->ones, sense, rhs, NULL);
+	if (error)
+		gurobi_err(lp);
+}
+
+static void
+grb_order(Lpsink * sink, uint i, uint j) {
+	Lp *lp = sink->arg;
+	int ind[2], error;
+	double coef[2] = { 1.0, -1.0 };
+
+	ind[0] = i;
+	ind[1] = j;
+	error = GRBaddconstr(lp->model, 2, ind, coef, GRB_GREATER_EQUAL, 0.0, NULL);
+	if (error)
+		gurobi_err(lp);
+}
+
+/* Model for expanding g, the same as the output of lpgraph -R would
+   be, but without going through LP text.  Edges fixed by g are
+   bounds, only the edges through the new vertex are in rows.  The
+   variables are named x# as in lpgraph, so that a model saved by
+   save_state() can be split by split.py and read by extsolve. */
+static void
+build_model(Lp * lp, Graph * g, Complete_graph * K, Complete_graph * K_p, uint k, uint M) {
+	Lpsink sink;
+	char *vtype, **names, *name;
+	int error;
+	uint i;
+
+	if (!lp->ones) {
+		lp->ones = g_malloc(K_p->m * sizeof(double));
+		for (i = 0; i < K_p->m; i++)
+			lp->ones[i] = 1.0;
+	}
+	vtype = g_malloc(K_p->m * sizeof(char));
+	names = g_malloc(K_p->m * sizeof(char *));
+	name = g_malloc(K_p->m * 12);
+	for (i = 0; i < K_p->m; i++) {
+		vtype[i] = GRB_BINARY;
+		names[i] = name + i * 12;
+		snprintf(names[i], 12, "x%u", i);
+	}
+
+	error = GRBnewmodel(lp->env, &lp->model, NULL, K_p->m, lp->ones, NULL, NULL, vtype, names);
+	free(names);
+	free(name);
+	if (error)
+		gurobi_err(lp);
+	error = GRBsetintattr(lp->model, GRB_INT_ATTR_MODELSENSE, GRB_MAXIMIZE);
+	if (error)
+		gurobi_err(lp);
+
+	sink.row = grb_row;
+	sink.order = grb_order;
+	sink.arg = lp;
+	lp_reduced_rows(g, K, K_p, k, M, options->lambda, &sink);
+	if (options->symmetry)
+		lp_symmetry_rows(g, K, K_p, &sink);
+
+	error = GRBupdatemodel(lp->model);
+	if (error)
+		gurobi_err(lp);
+
+	lp->n_vars = K_p->m;
+	set_params(lp);
+
+	free(vtype);
+}
+
+static int
+solve(Lp * lp) {
 	int error, status;
 	GRBenv *env;
 
-	error = GRBoptimize(model);
+	error = GRBoptimize(lp->model);
 	if (error)
-		gurobi_err();
+		gurobi_err(lp);
 
-	error = GRBgetintattr(model, GRB_INT_ATTR_STATUS, &status);
+	error = GRBgetintattr(lp->model, GRB_INT_ATTR_STATUS, &status);
 	if (error)
-		gurobi_err();
+		gurobi_err(lp);
 
 	if (status == GRB_INF_OR_UNBD) {
 		errmsg("WARNING: Could not solve, turning off presolve and retrying\n");
 
-		env = GRBgetenv(model);
+		env = GRBgetenv(lp->model);
 		if (!env)
-			gurobi_err();
+			gurobi_err(lp);
 
 		error = GRBsetintparam(env, GRB_INT_PAR_PRESOLVE, 0);
 		if (error)
-			gurobi_err();
+			gurobi_err(lp);
 
-		return solve();
+		return solve(lp);
 	}
 	return status;
 }
@@ -152,16 +336,16 @@ solve() {
    otherwise. `val' is the number of edges in the graph.
 */
 static void
-get_solution(int *x, int *val) {
+get_solution(Lp * lp, int *x, int *val) {
 	int i, error;
 	double sol;
 
 	(*val) = 0;
 
-	for (i = 0; i < n_vars; i++) {
-		error = GRBgetdblattrelement(model, "X", i, &sol);
+	for (i = 0; i < lp->n_vars; i++) {
+		error = GRBgetdblattrelement(lp->model, "X", i, &sol);
 		if (error)
-			gurobi_err();
+			gurobi_err(lp);
 
 		if (sol > 0.001) {
 			(*val)++;
@@ -172,28 +356,45 @@ get_solution(int *x, int *val) {
 	}
 }
 
+/* One line, cube workers share fp, and the lock of fp is also that
+   of lp->found */
 static void
-write_soln(int *x, FILE * fp) {
+write_soln(Lp * lp, int *x, FILE * fp) {
+	ulong *key = NULL;
 	int i;
 
-	for (i = 0; i < n_vars; i++)
-		if (x[i])
-			fprintf(fp, "%d ", i);
-	fputc('\n', fp);
+	if (lp->found) {
+		key = g_calloc(BITS_WORDS(lp->n_vars), sizeof(ulong));
+		for (i = 0; i < lp->n_vars; i++)
+			if (x[i])
+				BIT_SET(key, i);
+	}
+	flockfile(fp);
+	if (!key || certset_add(lp->found, key, NULL, lp->finder)) {
+		for (i = 0; i < lp->n_vars; i++)
+			if (x[i])
+				fprintf(fp, "%d ", i);
+		fputc('\n', fp);
+	}
+	funlockfile(fp);
+	free(key);
 }
 
 /* Add the contraint that at least one
-   of the variables x_i that are 1 be 0. */
+   of the variables x_i that are 1 be 0.
+   The k-th is named nogood<k>, after the
+   k-th line of the solutions, see replay(). */
 static void
-add_constraint(int *x, int m) {
+add_constraint(Lp * lp, int *x, int m) {
 	int *indices;
 	double *coeffs;
 	int error, i, j;
+	char name[32];
 
 	indices = g_malloc(sizeof(int) * m);
 	coeffs = g_malloc(sizeof(double) * m);
 
-	for (i = 0, j = 0; i < n_vars; i++) {
+	for (i = 0, j = 0; i < lp->n_vars; i++) {
 		if (x[i]) {
 			coeffs[j] = 1.0;
 			indices[j] = i;
@@ -201,15 +402,81 @@ add_constraint(int *x, int m) {
 		}
 	}
 
-	error = GRBaddconstr(model, m, indices, coeffs, GRB_LESS_EQUAL, m - 1, NULL);
+	snprintf(name, sizeof(name), "nogood%u", lp->nogoods++);
+	error = GRBaddconstr(lp->model, m, indices, coeffs, GRB_LESS_EQUAL, m - 1, name);
 	if (error)
-		gurobi_err();
+		gurobi_err(lp);
 
 	free(indices);
 	free(coeffs);
 
 }
 
+/* The output file is a journal of the solutions found.  Every line
+   has a no-good, and the model is only written at the end of a run,
+   so a run that was stopped is resumed from the saved LP and the
+   solutions found since, which are the lines after its no-goods.  A
+   line cut off when the run was stopped is removed. */
+static void
+replay(Lp * lp, const char *path) {
+	FILE *fp;
+	int *x, c, v, m;
+	uint line = 0, added = 0;
+	long good = 0;
+
+	if (access(path, F_OK))
+		return;
+	fp = f_open(path, "r");
+	x = g_calloc(lp->n_vars, sizeof(int));
+	m = 0;
+	v = -1;
+	while ((c = getc(fp)) != EOF) {
+		if (isdigit(c)) {
+			v = (v < 0 ? 0 : 10 * v) + c - '0';
+			continue;
+		}
+		if (v >= 0) {
+			if (v >= lp->n_vars) {
+				errmsg("FATAL: %s, line %u: no variable %d in the LP\n", path, line + 1, v);
+				exit(EXIT_FAILURE);
+			}
+			m += !x[v];
+			x[v] = 1;
+			v = -1;
+		}
+		if (c == '\n') {
+			if (line++ >= lp->nogoods) {
+				add_constraint(lp, x, m);
+				added++;
+			}
+			memset(x, 0, lp->n_vars * sizeof(int));
+			m = 0;
+			good = ftell(fp);
+		}
+	}
+	if (ferror(fp)) {
+		errmsg("FATAL: %s: %s\n", path, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if (ftell(fp) != good && truncate(path, good)) {
+		errmsg("FATAL: truncate: %s: %s\n", path, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	f_close(fp);
+	free(x);
+
+	if (!options->quiet)
+		infomsg("Resuming after %u solutions, %u of them not in the LP\n", line, added);
+}
+
+/* Solutions written so far are on disk when this returns */
+static void
+sync_journal(FILE * fp) {
+	fflush(fp);
+	if (fp != stdout && fsync(fileno(fp)))
+		errmsg("ERROR: fsync: %s\n", strerror(errno));
+}
+
 static int
 time_left(time_t start_time) {
 	time_t now;
@@ -223,88 +490,271 @@ time_left(time_t start_time) {
 	return now - start_time < options->timelimit;
 }
 
+/* Write the model back to its LP file, not for cubes, which have none */
 static void
-save_state() {
+save_state(Lp * lp) {
 	int error;
+
+	if (!lp->path)
+		return;
 	if (!options->quiet)
 		infomsg("Saving current state of LP\n");
 
-	if (model) {
-		error = GRBupdatemodel(model);
+	if (lp->model) {
+		error = GRBupdatemodel(lp->model);
 		if (error)
-			gurobi_err();
-		error = GRBwrite(model, options->infile);
+			gurobi_err(lp);
+		error = GRBwrite(lp->model, lp->path);
 		if (error)
-			gurobi_err();
+			gurobi_err(lp);
 	}
 }
 
+/* The signal that stops the run, 0 if none */
+static volatile sig_atomic_t caught;
+
+/* Gurobi isn't called from the handler but from the callbacks, which
+   stop the search once a signal is caught, and the run ends as if a
+   limit was reached, but without writing the model, see replay().  A
+   second signal exits at once. */
 static void
 sighandler(int sig) {
-	errmsg("Caught signal %d\n", sig);
-
-	/* FIXME: Is there a way make gurobi play nice with signals? */
-	/*
-	   GRBterminate(model);
-	   save_state();
-	 */
+	if (caught)
+		_exit(128 + sig);
+	caught = sig;
+}
 
-	/* With exit() we can at least flush
-	   output file on unexpected shutdown. */
-	exit(EXIT_FAILURE);
+static int
+stop_callback(GRBmodel * model, void *cbdata, int where, void *usrdata) {
+	(void)cbdata;
+	(void)where;
+	(void)usrdata;
+
+	if (caught)
+		GRBterminate(model);
+	return 0;
 }
 
-int
-main(int argc, char *argv[]) {
-	int *soln, status, m, retval = 0, error;
+#if GRB_VERSION_MAJOR >= 5
+/* State of the callback of enumerate_all() */
+typedef struct {
+	Lp *lp;
 	FILE *fp;
-	uint solutions = 0;
-	uint time_limit_is_set = 0;
-	uint writeback = 0;
-	char *out_filename;
-	size_t len;
-	GRBenv *env;
+	Certset *found;		/* every solution seen, as a bitset of edges */
+	ulong *key;
+	double *x;
+	int *ind;
+	double *ones;
+	uint solutions;
 	time_t start_time;
+	int status;		/* why the search was terminated, 0 if it wasn't */
+} enum_t;
 
-	init(argc, argv, "qvf:aD:o:T:t:s:S:w:p");
+/* Called by gurobi during the search.  Every new integer solution
+   is written to the output and then cut off with a lazy no-good,
+   so the search goes on until it has rejected all of them. */
+static int
+enum_callback(GRBmodel * model, void *cbdata, int where, void *usrdata) {
+	enum_t *E = usrdata;
+	int i, nz, error;
 
-	if (options->help)
-		usage(argv[0]);
+	if (where == GRB_CB_MIPSOL) {
+		error = GRBcbget(cbdata, where, GRB_CB_MIPSOL_SOL, E->x);
+		if (error)
+			return error;
 
-	if (signal(SIGINT, SIG_IGN) != SIG_IGN)
-		if (signal(SIGINT, sighandler) == SIG_ERR)
-			errmsg("ERROR: Cannot set up signal handler for SIGINT\n");
-	if (signal(SIGTERM, SIG_IGN) != SIG_IGN)	/* TODO: can TERM be ignored? */
-		if (signal(SIGTERM, sighandler) == SIG_ERR)
-			errmsg("ERROR: Cannot set up signal handler for SIGTERM\n");
-	if (signal(SIGHUP, SIG_IGN) != SIG_IGN)	/* TODO: can HUP be ignored? */
-		if (signal(SIGHUP, sighandler) == SIG_ERR)
-			errmsg("ERROR: Cannot set up signal handler for SIGHUP\n");
+		memset(E->key, 0, BITS_WORDS(E->lp->n_vars) * sizeof(ulong));
+		for (i = 0, nz = 0; i < E->lp->n_vars; i++)
+			if (E->x[i] > 0.5) {
+				BIT_SET(E->key, i);
+				E->ind[nz++] = i;
+			}
 
-	init_gurobi(options->infile);
+		/* The same solution can be found again, by another
+		   thread or heuristic, before its cut is in every node */
+		if (certset_add(E->found, E->key, NULL, 0)) {
+			flockfile(E->fp);
+			if (!E->lp->found || certset_add(E->lp->found, E->key, NULL, E->lp->finder)) {
+				for (i = 0; i < nz; i++)
+					fprintf(E->fp, "%d ", E->ind[i]);
+				fputc('\n', E->fp);
+			}
+			funlockfile(E->fp);
+			E->solutions++;
 
-	start_time = time(NULL);
+			if (!options->quiet) {
+				fprintf(stderr, ".");
+				fflush(stderr);
+			}
+			if (options->writeback > 0 && E->solutions % options->writeback == 0)
+				sync_journal(E->fp);
+		}
 
-	len = strlen(options->infile) + strlen(".soln") + 1;
-	out_filename = g_malloc(len);
-	snprintf(out_filename, len, "%s.soln", options->infile);
+		error = GRBcblazy(cbdata, nz, E->ind, E->ones, GRB_LESS_EQUAL, nz - 1);
+		if (error)
+			return error;
 
-	fp = open_outfile("%s/%s", options->graph_dir, basename(out_filename));
-	if (!fp) {		/* should only happen if output file exists and noclobber is set */
+		if (options->solutions_max > 0 && E->solutions >= options->solutions_max && !E->status) {
+			E->status = GRB_SOLUTION_LIMIT;
+			GRBterminate(model);
+		}
+	}
+
+	if (caught && !E->status) {
+		E->status = GRB_INTERRUPTED;
+		GRBterminate(model);
+	}
+
+	if (options->solutions_min && E->solutions >= options->solutions_min
+	    && !E->status && !time_left(E->start_time)) {
+		E->status = GRB_TIME_LIMIT;
+		GRBterminate(model);
+	}
+
+	return 0;
+}
+
+/* As solve_all(), but in a single branch and bound.  Solutions are
+   rejected by lazy constraints as they are found, the search ends
+   when there are no more.  If it's stopped by a limit, the no-goods
+   of the solutions found are added to the model before it's saved. */
+static int
+enumerate_all(Lp * lp, FILE * fp) {
+	enum_t E;
+	GRBenv *env;
+	int *soln, status, retval, error, nz, i;
+	uint j;
+
+	E.lp = lp;
+	E.fp = fp;
+	E.found = certset_new(BITS_WORDS(lp->n_vars), 0);
+	E.key = g_calloc(BITS_WORDS(lp->n_vars), sizeof(ulong));
+	E.x = g_malloc(lp->n_vars * sizeof(double));
+	E.ind = g_malloc(lp->n_vars * sizeof(int));
+	E.ones = g_malloc(lp->n_vars * sizeof(double));
+	for (i = 0; i < lp->n_vars; i++)
+		E.ones[i] = 1.0;
+	E.solutions = 0;
+	E.start_time = time(NULL);
+	E.status = 0;
+
+	env = GRBgetenv(lp->model);
+	if (!env)
+		gurobi_err(lp);
+	error = GRBsetintparam(env, GRB_INT_PAR_LAZYCONSTRAINTS, 1);
+	if (error)
+		gurobi_err(lp);
+	error = GRBsetcallbackfunc(lp->model, enum_callback, &E);
+	if (error)
+		gurobi_err(lp);
+
+	status = caught ? GRB_INTERRUPTED : solve(lp);
+	if (E.status)
+		status = E.status;
+
+	if (E.solutions && !options->quiet)
+		fputs("\n", stderr);	/* newline after solution dots */
+	lp->solutions += E.solutions;
+
+	switch (status) {
+	case GRB_SOLUTION_LIMIT:
+	case GRB_TIME_LIMIT:
+		retval = EXIT_UNFINISHED;
 		if (!options->quiet)
-			infomsg("NOTICE: No output file, exiting\n");
-		return 0;
+			errmsg("WARNING: %s limit was reached, LP might have more solutions\n",
+			       status == GRB_TIME_LIMIT ? "Time" : "Solution");
+		sync_journal(fp);
+
+		soln = g_calloc(lp->n_vars, sizeof(int));
+		for (j = 0; j < certset_count(E.found); j++) {
+			for (i = 0, nz = 0; i < lp->n_vars; i++)
+				if ((soln[i] = BIT_ISSET(certset_key(E.found, j), i) != 0))
+					nz++;
+			add_constraint(lp, soln, nz);
+		}
+		free(soln);
+		save_state(lp);
+		break;
+
+	case GRB_INTERRUPTED:
+		retval = EXIT_FAILURE;
+		sync_journal(fp);
+		break;
+
+	case GRB_INFEASIBLE:
+	case GRB_INF_OR_UNBD:
+		retval = EXIT_SUCCESS;
+		break;
+
+	default:
+		retval = EXIT_FAILURE;
+		errmsg("WARNING: status = %d\n", status);
 	}
 
-	free(out_filename);
+	if (!options->quiet) {
+		if (E.solutions == 1)
+			infomsg("Found %u graph\n", E.solutions);
+		else
+			infomsg("Found %u graphs\n", E.solutions);
+	}
+
+	error = GRBsetcallbackfunc(lp->model, stop_callback, NULL);
+	if (error)
+		gurobi_err(lp);
+
+	certset_free(E.found);
+	free(E.key);
+	free(E.x);
+	free(E.ind);
+	free(E.ones);
+
+	return retval;
+}
+#endif
 
-	soln = g_calloc(n_vars, sizeof(int));
+/* Run log record of an LP solved with exit status ret, rows are
+   those it had before solving */
+static void
+log_lp(Lp * lp, const char *path, Runclock * clock, uint N, uint M, int rows, long bytes, int ret) {
+	char *p = json_escape(path);
+
+	runlog("lpsolve", clock, "\"lp\": \"%s\", \"N\": %u, \"M\": %u, \"vars\": %d, \"rows\": %d, "
+	       "\"status\": \"%s\", \"solutions\": %u, \"bytes\": %ld", p, N, M, lp->n_vars, rows,
+	       caught ? "interrupted" : ret == EXIT_SUCCESS ? "solved" : ret == EXIT_UNFINISHED ? "unfinished" : "failed",
+	       lp->solutions, bytes);
+	free(p);
+}
+
+/* Find all solutions of model, or until a limit is reached, one
+   solution per line to fp.  Returns the exit status. */
+static int
+solve_all(Lp * lp, FILE * fp) {
+	int *soln, status, m, retval = 0, error;
+	uint solutions = 0;
+	uint time_limit_is_set = 0;
+	uint writeback = 0;
+	GRBenv *env;
+	time_t start_time;
+
+#if GRB_VERSION_MAJOR >= 5
+	if (options->enumerate)
+		return enumerate_all(lp, fp);
+#endif
 
-	while ((status = solve()) == GRB_OPTIMAL) {
-		get_solution(soln, &m);
-		write_soln(soln, fp);
-		add_constraint(soln, m);
+	error = GRBsetcallbackfunc(lp->model, stop_callback, NULL);
+	if (error)
+		gurobi_err(lp);
+
+	start_time = time(NULL);
+
+	soln = g_calloc(lp->n_vars, sizeof(int));
+
+	while (!caught && (status = solve(lp)) == GRB_OPTIMAL) {
+		get_solution(lp, soln, &m);
+		write_soln(lp, soln, fp);
+		add_constraint(lp, soln, m);
 		solutions++;
+		lp->solutions++;
 
 		if (!options->quiet) {
 			fprintf(stderr, ".");
@@ -312,10 +762,8 @@ main(int argc, char *argv[]) {
 		}
 
 		if (options->writeback > 0 && ++writeback == options->writeback) {
-			if (!options->quiet)
-				fputc('\n', stderr);
 			writeback = 0;
-			save_state();
+			sync_journal(fp);
 		}
 
 		if (solutions >= options->solutions_min) {
@@ -323,13 +771,13 @@ main(int argc, char *argv[]) {
 			    && time_limit_is_set == 0) {
 				time_limit_is_set = 1;
 
-				env = GRBgetenv(model);
+				env = GRBgetenv(lp->model);
 				if (!env)
-					gurobi_err();
+					gurobi_err(lp);
 
 				error = GRBsetdblparam(env, GRB_DBL_PAR_TIMELIMIT, options->timelimit);
 				if (error)
-					gurobi_err();
+					gurobi_err(lp);
 			}
 
 			if (!time_left(start_time)) {
@@ -344,24 +792,33 @@ main(int argc, char *argv[]) {
 		}
 	}
 
+	if (caught)
+		status = GRB_INTERRUPTED;
 	if (solutions && !options->quiet)
 		fputs("\n", stderr);	/* newline after solution dots */
 
+	/* The journal goes first, the no-goods of a saved model
+	   must be lines of it */
 	switch (status) {
 	case GRB_SOLUTION_LIMIT:
 		retval = EXIT_UNFINISHED;
 		if (!options->quiet)
 			errmsg("WARNING: Solution limit was reached, LP might have more solutions\n");
-		fflush(fp);
-		save_state();
+		sync_journal(fp);
+		save_state(lp);
 		break;
 
 	case GRB_TIME_LIMIT:
 		retval = EXIT_UNFINISHED;
 		if (!options->quiet)
 			errmsg("WARNING: Time limit was reached, LP might have more solutions\n");
-		fflush(fp);
-		save_state();
+		sync_journal(fp);
+		save_state(lp);
+		break;
+
+	case GRB_INTERRUPTED:
+		retval = EXIT_FAILURE;
+		sync_journal(fp);
 		break;
 
 	case GRB_INFEASIBLE:
@@ -382,8 +839,613 @@ main(int argc, char *argv[]) {
 			infomsg("Found %u graphs\n", solutions);
 	}
 
-	f_close(fp);
 	free(soln);
 
 	return retval;
 }
+
+#define MAX_CUBES 16
+
+/* The -j slots that no thread is solving in.  Each worker of -M
+   holds one, and gives it back when the graphs run out, so that
+   conquer() never runs more than -j models at once. */
+static uint idle_slots;
+static pthread_mutex_t slots_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void
+give_slots(uint n) {
+	pthread_mutex_lock(&slots_lock);
+	idle_slots += n;
+	pthread_mutex_unlock(&slots_lock);
+}
+
+#if GRB_VERSION_MAJOR >= 5
+/* Take up to n idle slots, returns how many were taken */
+static uint
+take_slots(uint n) {
+	pthread_mutex_lock(&slots_lock);
+	if (n > idle_slots)
+		n = idle_slots;
+	idle_slots -= n;
+	pthread_mutex_unlock(&slots_lock);
+	return n;
+}
+
+/* Cube and conquer.  An LP that hits a limit is split on a few of its
+   free variables into 2^-c cubes, the LP with those variables fixed
+   each way, which are solved by -j workers.  Every worker reads its
+   own model from the saved LP, and splits a cube that hits a limit
+   again the same way.  A worker takes the cubes it made itself, the
+   last first, and when it has none it steals the oldest cube of
+   another worker, which is the largest.
+
+   A cube split after some of its solutions were found must not find
+   them again, so the solutions of all workers are kept in one set,
+   and a worker adds those of the others to its model as no-goods
+   before it solves a cube. */
+
+typedef struct {
+	uint nfix;
+	int *var;
+	char *val;
+} cube_t;
+
+typedef struct {
+	cube_t **cube;
+	uint head, tail, size;
+} deque_t;
+
+typedef struct {
+	const char *path;
+	FILE *fp;
+	Certset *found;		/* solutions written, locked with fp */
+	uint workers;
+	deque_t *dq;		/* one per worker */
+	uint busy;		/* workers solving a cube */
+	uint solutions;
+	int retval;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+} conquer_t;
+
+typedef struct {
+	conquer_t *C;
+	uint w;
+	uint synced;		/* solutions of C->found in the model */
+} worker_t;
+
+/* Free variables to split on, at most c of them, to var.  Returns
+   how many there are.  A variable scores by how fractional it is in
+   the LP relaxation, so that both sides of the split are about as
+   hard, times the number of rows it's in, so that fixing it says a
+   lot about the others. */
+static uint
+pick_vars(Lp * lp, uint c, int *var) {
+	GRBmodel *relax;
+	double *x, *lb, *ub, *score, *vval, best;
+	int *vbeg, *vind, numnz, status, error, n = lp->n_vars, i;
+	uint picked;
+
+	x = g_malloc(n * sizeof(double));
+	lb = g_malloc(n * sizeof(double));
+	ub = g_malloc(n * sizeof(double));
+	score = g_malloc(n * sizeof(double));
+	vbeg = g_malloc((n + 1) * sizeof(int));
+
+	error = GRBupdatemodel(lp->model);
+	if (!error)
+		error = GRBgetdblattrarray(lp->model, GRB_DBL_ATTR_LB, 0, n, lb);
+	if (!error)
+		error = GRBgetdblattrarray(lp->model, GRB_DBL_ATTR_UB, 0, n, ub);
+	if (!error)
+		error = GRBgetvars(lp->model, &numnz, NULL, NULL, NULL, 0, n);
+	if (error)
+		gurobi_err(lp);
+	vind = g_malloc((numnz + 1) * sizeof(int));
+	vval = g_malloc((numnz + 1) * sizeof(double));
+	error = GRBgetvars(lp->model, &numnz, vbeg, vind, vval, 0, n);
+	if (error)
+		gurobi_err(lp);
+	vbeg[n] = numnz;
+
+	for (i = 0; i < n; i++)
+		x[i] = 0.5;
+	error = GRBrelaxmodel(lp->model, &relax);
+	if (error)
+		gurobi_err(lp);
+	error = GRBoptimize(relax);
+	if (!error)
+		error = GRBgetintattr(relax, GRB_INT_ATTR_STATUS, &status);
+	if (!error && status == GRB_OPTIMAL)
+		error = GRBgetdblattrarray(relax, GRB_DBL_ATTR_X, 0, n, x);
+	GRBfreemodel(relax);
+	if (error)
+		gurobi_err(lp);
+
+	for (i = 0; i < n; i++)
+		score[i] = lb[i] < ub[i] ? ((x[i] < 0.5 ? x[i] : 1 - x[i]) + 0.01) * (1 + vbeg[i + 1] - vbeg[i]) : -1;
+
+	for (picked = 0; picked < c; picked++) {
+		best = 0;
+		var[picked] = -1;
+		for (i = 0; i < n; i++)
+			if (score[i] > best) {
+				best = score[i];
+				var[picked] = i;
+			}
+		if (var[picked] < 0)
+			break;
+		score[var[picked]] = -1;
+	}
+
+	free(x);
+	free(lb);
+	free(ub);
+	free(score);
+	free(vbeg);
+	free(vind);
+	free(vval);
+
+	return picked;
+}
+
+static void
+push_cube(conquer_t * C, uint w, cube_t * cube) {
+	deque_t *D = C->dq + w;
+
+	pthread_mutex_lock(&C->lock);
+	if (D->tail == D->size) {
+		memmove(D->cube, D->cube + D->head, (D->tail - D->head) * sizeof(cube_t *));
+		D->tail -= D->head;
+		D->head = 0;
+		if (D->tail * 2 >= D->size) {
+			D->size = D->size ? 2 * D->size : 64;
+			D->cube = g_realloc(D->cube, D->size * sizeof(cube_t *));
+		}
+	}
+	D->cube[D->tail++] = cube;
+	pthread_cond_signal(&C->cond);
+	pthread_mutex_unlock(&C->lock);
+}
+
+/* Next cube for worker w, with the lock held, NULL if there are none */
+static cube_t *
+take_cube(conquer_t * C, uint w) {
+	deque_t *D;
+	uint i;
+
+	if (C->dq[w].tail > C->dq[w].head)
+		return C->dq[w].cube[--C->dq[w].tail];
+	for (i = 1; i < C->workers; i++) {
+		D = C->dq + (w + i) % C->workers;
+		if (D->tail > D->head)
+			return D->cube[D->head++];
+	}
+	return NULL;
+}
+
+/* The 2^n cubes of parent with var[0 .. n) also fixed, to worker w */
+static void
+split_cube(conquer_t * C, uint w, cube_t * parent, int *var, uint n) {
+	cube_t *cube;
+	uint b, i, nfix = parent ? parent->nfix : 0;
+
+	for (b = 0; b < 1u << n; b++) {
+		cube = g_malloc(sizeof(cube_t));
+		cube->nfix = nfix + n;
+		cube->var = g_malloc(cube->nfix * sizeof(int));
+		cube->val = g_malloc(cube->nfix);
+		if (parent) {
+			memcpy(cube->var, parent->var, nfix * sizeof(int));
+			memcpy(cube->val, parent->val, nfix);
+		}
+		for (i = 0; i < n; i++) {
+			cube->var[nfix + i] = var[i];
+			cube->val[nfix + i] = (b >> i) & 1;
+		}
+		push_cube(C, parent ? w : b % C->workers, cube);
+	}
+}
+
+static void
+fix_cube(Lp * lp, cube_t * cube, int fix) {
+	int error = 0;
+	uint i;
+
+	for (i = 0; !error && i < cube->nfix; i++) {
+		error = GRBsetdblattrelement(lp->model, GRB_DBL_ATTR_LB, cube->var[i], fix ? cube->val[i] : 0.0);
+		if (!error)
+			error = GRBsetdblattrelement(lp->model, GRB_DBL_ATTR_UB, cube->var[i], fix ? cube->val[i] : 1.0);
+	}
+	if (!error)
+		error = GRBupdatemodel(lp->model);
+	if (error)
+		gurobi_err(lp);
+}
+
+/* No-goods of the solutions found by other workers since last time */
+static void
+sync_found(worker_t * W, Lp * lp) {
+	conquer_t *C = W->C;
+	int *soln, i, nz;
+
+	soln = g_malloc(lp->n_vars * sizeof(int));
+	flockfile(C->fp);
+	for (; W->synced < certset_count(C->found); W->synced++) {
+		if (*certset_flag(C->found, W->synced) == lp->finder)
+			continue;
+		for (i = 0, nz = 0; i < lp->n_vars; i++)
+			if ((soln[i] = BIT_ISSET(certset_key(C->found, W->synced), i) != 0))
+				nz++;
+		add_constraint(lp, soln, nz);
+	}
+	funlockfile(C->fp);
+	free(soln);
+}
+
+/* Solve cube, splitting it if a limit is hit.  If there is nothing
+   left to split on the limit is only a pause, it's solved again. */
+static int
+solve_cube(conquer_t * C, uint w, Lp * lp, cube_t * cube) {
+	int var[MAX_CUBES], ret;
+	uint n = 0;
+
+	fix_cube(lp, cube, 1);
+	while ((ret = solve_all(lp, C->fp)) == EXIT_UNFINISHED)
+		if ((n = pick_vars(lp, options->cubes, var)))
+			break;
+	fix_cube(lp, cube, 0);
+
+	if (ret == EXIT_UNFINISHED) {
+		split_cube(C, w, cube, var, n);
+		ret = EXIT_SUCCESS;
+	}
+
+	free(cube->var);
+	free(cube->val);
+	free(cube);
+
+	return ret;
+}
+
+static void *
+conquer_worker(void *p) {
+	worker_t *W = p;
+	conquer_t *C = W->C;
+	cube_t *cube;
+	Lp lp;
+	int ret;
+
+	init_gurobi(&lp, C->path);
+	lp.path = NULL;
+	lp.found = C->found;
+	lp.finder = W->w + 1;
+
+	pthread_mutex_lock(&C->lock);
+	for (;;) {
+		if (C->retval == EXIT_FAILURE)
+			break;
+		if (!(cube = take_cube(C, W->w))) {
+			if (!C->busy)
+				break;
+			pthread_cond_wait(&C->cond, &C->lock);
+			continue;
+		}
+		C->busy++;
+		pthread_mutex_unlock(&C->lock);
+
+		sync_found(W, &lp);
+		ret = solve_cube(C, W->w, &lp, cube);
+
+		pthread_mutex_lock(&C->lock);
+		C->busy--;
+		if (ret != EXIT_SUCCESS)
+			C->retval = EXIT_FAILURE;
+		pthread_cond_broadcast(&C->cond);
+	}
+	C->solutions += lp.solutions;
+	pthread_cond_broadcast(&C->cond);
+	pthread_mutex_unlock(&C->lock);
+
+	GRBfreemodel(lp.model);
+	GRBfreeenv(lp.env);
+
+	return NULL;
+}
+
+/* Finish lp, which solve_all() left unfinished and saved, by cube and
+   conquer, with the calling thread's slot and those that are idle.
+   The solutions found before the split are no-goods of the saved LP
+   that every worker reads. */
+static int
+conquer(Lp * lp, FILE * fp) {
+	conquer_t C;
+	worker_t *W;
+	pthread_t *tids;
+	int var[MAX_CUBES];
+	uint i, n;
+
+	n = pick_vars(lp, options->cubes, var);
+	if (!n)
+		return EXIT_UNFINISHED;
+
+	C.workers = 1 + take_slots(options->jobs - 1);
+	if (!options->quiet)
+		infomsg("Splitting LP into %u cubes, %u workers\n", 1u << n, C.workers);
+
+	C.path = lp->path;
+	C.fp = fp;
+	C.found = certset_new(BITS_WORDS(lp->n_vars), 0);
+	C.dq = g_calloc(C.workers, sizeof(deque_t));
+	C.busy = 0;
+	C.solutions = 0;
+	C.retval = EXIT_SUCCESS;
+	pthread_mutex_init(&C.lock, NULL);
+	pthread_cond_init(&C.cond, NULL);
+	split_cube(&C, 0, NULL, var, n);
+
+	W = g_malloc(C.workers * sizeof(worker_t));
+	tids = g_malloc(C.workers * sizeof(pthread_t));
+	for (i = 0; i < C.workers; i++) {
+		W[i].C = &C;
+		W[i].w = i;
+		W[i].synced = 0;
+		if ((errno = pthread_create(tids + i, NULL, conquer_worker, W + i))) {
+			errmsg("FATAL: pthread_create: %s\n", strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+	}
+	for (i = 0; i < C.workers; i++)
+		pthread_join(tids[i], NULL);
+	give_slots(C.workers - 1);
+
+	for (i = 0; i < C.workers; i++) {
+		while (C.dq[i].tail > C.dq[i].head) {
+			C.dq[i].tail--;
+			free(C.dq[i].cube[C.dq[i].tail]->var);
+			free(C.dq[i].cube[C.dq[i].tail]->val);
+			free(C.dq[i].cube[C.dq[i].tail]);
+		}
+		free(C.dq[i].cube);
+	}
+	pthread_cond_destroy(&C.cond);
+	pthread_mutex_destroy(&C.lock);
+	certset_free(C.found);
+	free(C.dq);
+	free(tids);
+	free(W);
+
+	lp->solutions += C.solutions;
+	return C.retval;
+}
+#else
+static int
+conquer(Lp * lp, FILE * fp) {
+	(void)lp;
+	(void)fp;
+	return EXIT_UNFINISHED;
+}
+#endif
+
+/* Take graphs from the input file until it's empty, solving each
+   with its own model in this thread's environment */
+static void *
+solve_worker(void *p) {
+	batch_t *B = p;
+	Lp lp;
+	Graph *g;
+	FILE *fp;
+	char *path;
+	size_t len;
+	uint graph_no;
+	int ret, more, rows;
+	long bytes;
+	Runclock clock;
+
+	load_env(&lp);
+	len = strlen(options->graph_dir) + 128;
+	path = g_malloc(len);
+	lp.path = path;
+
+	g = Galloc(B->K->n, B->m);
+	for (;;) {
+		pthread_mutex_lock(&B->lock);
+		more = B->retval != EXIT_FAILURE && graphfile_read_into(B->in, B->K, g);
+		graph_no = B->graph_no++;
+		if (more) {
+			snprintf(path, len, "%s/solve%s-r=%u-k=%u-n=%u-m=%u-N=%u-M=%u_no=%u.lp",
+				 options->graph_dir, options->lambda == 2 ? "-double" : "",
+				 B->r, B->k, B->n, B->m, B->n + 1, B->M, graph_no);
+			fp = open_outfile("%s.soln", path);
+		}
+		pthread_mutex_unlock(&B->lock);
+		if (!more)
+			break;
+		if (!fp) {	/* should only happen if output file exists and noclobber is set */
+			if (!options->quiet)
+				infomsg("NOTICE: No output file for graph no. %u, skipping\n", graph_no);
+			continue;
+		}
+
+		runclock_start(&clock);
+		clock.shared = options->jobs > 1;
+		build_model(&lp, g, B->K, B->K_p, B->k, B->M);
+		lp.solutions = 0;
+		rows = model_rows(&lp);
+		bytes = file_bytes(fp);
+		ret = solve_all(&lp, fp);
+		if (ret == EXIT_UNFINISHED && options->cubes && (ret = conquer(&lp, fp)) == EXIT_SUCCESS)
+			unlink(path);
+		log_lp(&lp, path, &clock, B->n + 1, B->M, rows, file_bytes(fp) - bytes, ret);
+		f_close(fp);
+		GRBfreemodel(lp.model);
+		lp.model = NULL;
+
+		/* One line per graph, in the order they're done */
+		pthread_mutex_lock(&B->lock);
+		if (ret == EXIT_SUCCESS) {
+			fprintf(stdout, "Solved: %s.soln\n", path);
+		} else if (ret == EXIT_UNFINISHED) {
+			fprintf(stdout, "Unfinished: %s\n", path);
+			if (B->retval == EXIT_SUCCESS)
+				B->retval = EXIT_UNFINISHED;
+		} else {
+			B->retval = EXIT_FAILURE;
+		}
+		fflush(stdout);
+		pthread_mutex_unlock(&B->lock);
+	}
+
+	give_slots(1);
+	free_G(g);
+	free(path);
+	free(lp.ones);
+	GRBfreeenv(lp.env);
+
+	return NULL;
+}
+
+/* Expand every graph of the input file, see usage().  Graphs are
+   handed out one at a time to -j workers. */
+static int
+solve_graphs() {
+	batch_t B;
+	pthread_t *tids;
+	uint i, dummy;
+	Runclock clock;
+
+	runclock_start(&clock);
+	B.in = graphfile_open_in();
+	B.r = B.k = B.n = B.m = 0;
+	if (!graphfile_params(B.in, &B.r, &B.k, &B.n, &B.m) && options->infile)
+		parse_infile(&B.r, &B.k, &B.n, &B.m, &dummy, &dummy, PFN_r | PFN_k | PFN_n | PFN_m);
+	if (((!B.r && !(B.r = options->forbidden.r))
+	     || (!B.k && !(B.k = options->forbidden.k))
+	     || (!B.n && !(B.n = options->n))
+	     || (!B.m && !(B.m = options->m))))
+		usage("lpsolve");
+	B.M = options->target_m;
+
+	B.K = complete_graph(B.n, B.r);
+	B.K_p = complete_graph(B.n + 1, B.r);
+	B.graph_no = 0;
+	B.retval = EXIT_SUCCESS;
+	pthread_mutex_init(&B.lock, NULL);
+
+	tids = g_malloc(options->jobs * sizeof(pthread_t));
+	for (i = 0; i < options->jobs; i++)
+		if ((errno = pthread_create(tids + i, NULL, solve_worker, &B))) {
+			errmsg("FATAL: pthread_create: %s\n", strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+	for (i = 0; i < options->jobs; i++)
+		pthread_join(tids[i], NULL);
+
+	/* The records of the graphs are shared, this one has the cpu
+	   time and size of them all */
+	if (options->jobs > 1)
+		runlog("batch", &clock, "\"solver\": \"lpsolve\", \"N\": %u, \"M\": %u, \"jobs\": %u",
+		       B.n + 1, B.M, options->jobs);
+
+	if (read_line_errno)
+		B.retval = EXIT_FAILURE;
+
+	pthread_mutex_destroy(&B.lock);
+	free(tids);
+	free_K(B.K);
+	free_K(B.K_p);
+	graphfile_close(B.in);
+
+	return B.retval;
+}
+
+int
+main(int argc, char *argv[]) {
+	Lp lp;
+	FILE *fp;
+	int retval, rows;
+	char *out_filename;
+	size_t len;
+	uint N = 0, M = 0, dummy;
+	long bytes;
+	Runclock clock;
+
+	init(argc, argv, "qvf:aD:o:T:t:s:S:w:pr:k:n:m:M:dj:eyc:");
+
+	if (options->help)
+		usage(argv[0]);
+	/* every graph of -M has its own output file */
+	if (options->target_m && !options->use_default_outfile) {
+		errmsg("FATAL: -o can't be used with -M\n");
+		exit(EXIT_FAILURE);
+	}
+	if (options->cubes > MAX_CUBES) {
+		errmsg("FATAL: -c%u, at most %u variables can be split on at once\n", options->cubes, MAX_CUBES);
+		exit(EXIT_FAILURE);
+	}
+#if GRB_VERSION_MAJOR < 5
+	if (options->enumerate) {
+		errmsg("FATAL: -e needs lazy constraints, gurobi 5.0 or later\n");
+		exit(EXIT_FAILURE);
+	}
+	if (options->cubes) {
+		errmsg("FATAL: -c needs GRBrelaxmodel, gurobi 5.0 or later\n");
+		exit(EXIT_FAILURE);
+	}
+#endif
+
+	if (signal(SIGINT, SIG_IGN) != SIG_IGN)
+		if (signal(SIGINT, sighandler) == SIG_ERR)
+			errmsg("ERROR: Cannot set up signal handler for SIGINT\n");
+	if (signal(SIGTERM, SIG_IGN) != SIG_IGN)	/* TODO: can TERM be ignored? */
+		if (signal(SIGTERM, sighandler) == SIG_ERR)
+			errmsg("ERROR: Cannot set up signal handler for SIGTERM\n");
+	if (signal(SIGHUP, SIG_IGN) != SIG_IGN)	/* TODO: can HUP be ignored? */
+		if (signal(SIGHUP, sighandler) == SIG_ERR)
+			errmsg("ERROR: Cannot set up signal handler for SIGHUP\n");
+
+	if (options->target_m) {
+		retval = solve_graphs();
+		return caught ? 128 + caught : retval;
+	}
+
+	if (!options->infile)
+		usage(argv[0]);
+
+	runclock_start(&clock);
+	init_gurobi(&lp, options->infile);
+	parse_infile(&dummy, &dummy, &dummy, &dummy, &N, &M, PFN_N | PFN_M);
+
+	len = strlen(options->infile) + strlen(".soln") + 1;
+	out_filename = g_malloc(len);
+	snprintf(out_filename, len, "%s.soln", options->infile);
+
+	fp = open_outfile("%s/%s", options->graph_dir, basename(out_filename));
+	if (!fp) {		/* should only happen if output file exists and noclobber is set */
+		if (!options->quiet)
+			infomsg("NOTICE: No output file, exiting\n");
+		return 0;
+	}
+
+	free(out_filename);
+
+	if (options->append && fp != stdout)
+		replay(&lp, options->outfile);
+
+	rows = model_rows(&lp);
+	bytes = file_bytes(fp);
+	retval = solve_all(&lp, fp);
+	idle_slots = options->jobs - 1;
+	if (retval == EXIT_UNFINISHED && options->cubes)
+		retval = conquer(&lp, fp);
+	log_lp(&lp, options->infile, &clock, N, M, rows, file_bytes(fp) - bytes, retval);
+
+	f_close(fp);
+
+	if (caught) {
+		if (!options->quiet)
+			errmsg("Caught signal %d, the solutions found are in the output\n", (int)caught);
+		return 128 + caught;
+	}
+	return retval;
+}
@@ -32,9 +32,11 @@ source ./colordef.sh
 
 if `basename $0 | grep -q double`;then
 	DUBSUF="-double"
+	DOUBLE="-d"
 else
 	DUBSUF=""
 fi
+KNOWN="./known -q -r$r -k$k $DOUBLE"
 
 
 if [ $# -ne 4 ];then
@@ -50,10 +52,10 @@ mkdir -p $GRAPH_DIR/_helpers \
 echo -e "${COLOR_INFO}$0 $*${COLOR_RESET}"
 
 
-# Assume that all r-graphs on N vertices and M edges
-# have already been found if target file exists.
-TARGET_GRAPHS=$GRAPH_DIR/graphs-r=$r-k=$k-n=$N-m=$M.ei
-if [ -f $TARGET_GRAPHS ];then
+# All r-graphs on N vertices and M edges have
+# already been found if the catalogue says so.
+TARGET_GRAPHS=$GRAPH_DIR/graphs${DUBSUF}-r=$r-k=$k-n=$N-m=$M.ei
+if $KNOWN -n$N -m$M;then
 	echo "$TARGET_GRAPHS already exists, skipping"
 	exit 0
 fi
@@ -66,7 +68,7 @@ minm=$((M - M*r/N))
 # Check for the required graphs
 MISSING=$((M+1))
 for edges in `seq $minm $M`;do
-		if [ ! -f $GRAPH_DIR/graphs-r=$r-k=$k-n=$n-m=$edges.ei ];then
+		if ! $KNOWN -n$n -m$edges;then
 				MISSING=$edges
 				break;
 		fi
@@ -79,8 +81,8 @@ if [ $MISSING -eq $minm ];then
 		# No expansion needed for graphs on the same number
 		# of vertices as the forbidden graph.
 		MAXM=`./nCk $k $r`
-		echo "./seed -C -r$r -k$k -M$((MAXM-$minm))"
-		./seed -C -r$r -k$k -M$((MAXM-$minm))
+		echo "./seed -C $DOUBLE -r$r -k$k -M$((MAXM-$minm))"
+		./seed -C $DOUBLE -r$r -k$k -M$((MAXM-$minm))
 		if [ $? -ne 0 ];then
 			echo -e "${COLOR_ERROR}FATAL: seed did not exit cleanly ${COLOR_RESET}"
 			exit 1
@@ -101,8 +103,8 @@ fi
 for m in `seq $M -1 $minm`; do
 
 	# Graphs to expand.
-	graph=$GRAPH_DIR/graphs-r=$r-k=$k-n=$n-m=$m.ei
-	if [ ! -f $graph ];then
+	graph=$GRAPH_DIR/graphs${DUBSUF}-r=$r-k=$k-n=$n-m=$m.ei
+	if ! $KNOWN -n$n -m$m;then
 		continue
 	fi
 	echo "expanding $graph"
@@ -0,0 +1,151 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+# Copyright © 2011,2012,2013 Lars Lindqvist <lars.lindqvist at yandex.ru>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the “Software”),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+# DEALINGS IN THE SOFTWARE.
+
+# Summary of the run log, per level (N, M).  Every stage, lpgraph,
+# lpsolve or extsolve, sift, split.py and isoreduce, appends a JSON
+# record per LP or run to $LPRUNLOG, see runlog() in util.c.  lpsolve
+# and extsolve -M -j also write a batch record per run.
+#
+# usage: runlog.py [-H] [-j] [runlog ...]
+#	-H, a row per level and host, to tune LPTIMEOUT and LPMAXSOLN
+#	    for each host
+#	-j, JSON, one object per row, rather than a table
+# The log is $LPRUNLOG, or else $GRAPH_DIR/runlog, if none is given.
+
+from __future__ import print_function
+import getopt, json, os, sys
+
+SOLVERS = ('lpsolve', 'extsolve')
+
+# lps and the statuses are the records of lpsolve and extsolve, the
+# times of an LP are wall times, solutions may have repeats.  The times,
+# peak size and bytes are of all stages.  graphs and classes are read
+# and found by isoreduce.
+COLUMNS = ['lps', 'solved', 'unfinished', 'failed', 'interrupted',
+	'solutions', 'max_solutions', 'lp_median_s', 'lp_max_s',
+	'wall_h', 'cpu_h', 'maxrss_mib', 'lpgraph', 'sifted', 'infeasible',
+	'splits', 'max_depth', 'graphs', 'classes', 'bytes_mib']
+
+def usage():
+	sys.stderr.write('usage: %s [-H] [-j] [runlog ...]\n' % sys.argv[0])
+	sys.exit(1)
+
+def new_row():
+	row = dict([(c, 0) for c in COLUMNS])
+	row['lp_walls'] = []
+	return row
+
+def add(row, rec):
+	stage = rec.get('stage')
+	# The cpu time and size of a shared record are of all the LPs of
+	# its process, those are in the batch record of the process, whose
+	# wall time is already in those of its LPs.
+	if stage != 'batch':
+		row['wall_h'] += rec.get('wall_s', 0) / 3600.0
+	if not rec.get('shared'):
+		row['cpu_h'] += rec.get('cpu_s', 0) / 3600.0
+		row['maxrss_mib'] = max(row['maxrss_mib'], rec.get('maxrss_kib', 0) / 1024.0)
+	row['bytes_mib'] += rec.get('bytes', 0) / 1048576.0
+
+	if stage in SOLVERS:
+		row['lps'] += 1
+		status = rec.get('status', 'failed')
+		if status in row:
+			row[status] += 1
+		row['solutions'] += rec.get('solutions', 0)
+		row['max_solutions'] = max(row['max_solutions'], rec.get('solutions', 0))
+		row['lp_walls'].append(rec.get('wall_s', 0))
+	elif stage == 'lpgraph':
+		row['lpgraph'] += 1
+	elif stage == 'sift':
+		row['sifted'] += 1
+		if rec.get('status') == 'infeasible':
+			row['infeasible'] += 1
+	elif stage == 'split':
+		row['splits'] += 1
+		row['max_depth'] = max(row['max_depth'], rec.get('depth', 0))
+	elif stage == 'isoreduce':
+		row['graphs'] += rec.get('graphs', 0)
+		row['classes'] += rec.get('classes', 0)
+
+def finish(row):
+	walls = sorted(row.pop('lp_walls'))
+	if walls:
+		row['lp_median_s'] = walls[len(walls) // 2]
+		row['lp_max_s'] = walls[-1]
+	return row
+
+def fmt(v):
+	if isinstance(v, float):
+		return '%.2f' % v
+	return str(v)
+
+def main():
+	try:
+		opts, args = getopt.getopt(sys.argv[1:], 'Hj')
+	except getopt.GetoptError:
+		usage()
+	by_host = ('-H', '') in opts
+	as_json = ('-j', '') in opts
+
+	if not args:
+		log = os.environ.get('LPRUNLOG', '')
+		if log in ('', 'no'):
+			log = os.path.join(os.environ.get('GRAPH_DIR', '.'), 'runlog')
+		args = [log]
+
+	rows = {}
+	for path in args:
+		for n, line in enumerate(open(path)):
+			try:
+				rec = json.loads(line)
+			except ValueError:
+				sys.stderr.write('%s:%d: not a record, skipped\n' % (path, n + 1))
+				continue
+			key = (rec.get('N', 0), rec.get('M', 0))
+			if by_host:
+				key += (rec.get('host', ''),)
+			if key not in rows:
+				rows[key] = new_row()
+			add(rows[key], rec)
+
+	keys = ['N', 'M'] + (['host'] if by_host else [])
+	names = keys + COLUMNS
+	table = []
+	for key in sorted(rows):
+		row = finish(rows[key])
+		row.update(zip(keys, key))
+		table.append(row)
+
+	if as_json:
+		for row in table:
+			print(json.dumps(dict((c, row[c]) for c in names), sort_keys=True))
+		return
+
+	cells = [names] + [[fmt(row[c]) for c in names] for row in table]
+	widths = [max(len(r[i]) for r in cells) for i in range(len(names))]
+	for r in cells:
+		print('  '.join(c.rjust(w) for c, w in zip(r, widths)))
+
+if __name__ == '__main__':
+	main()
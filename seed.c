@@ -35,6 +35,7 @@ usage(const char *prog) {
 		"	 -q, quiet, surppress misc output\n"
 		"	 -o, write output to file, use `-' for stdout\n"
 		"	 -C, don't clobber output file\n"
+		"	 -d, double coverings, the files are graphs-double-r=#-...\n"
 		"	output: Non-isomorphic subgraphs of K^r_k\n"
 		"	  if -M is given, then only subgraphs with nCk - M edges\n"
 		"	  will be produced. Otherwise output will include every\n"
@@ -54,21 +55,21 @@ usage(const char *prog) {
 int
 main(int argc, char *argv[]) {
 	Complete_graph *K;
-	Graph *head;
-	uint m, k, r, minm, i, j;
+	GraphBatch *B;
+	uint m, k, r, minm, i;
+	const char *dubsuf;
 	FILE *fp;
-	Graph *forbidden, *tmp, *comp;
-	gsl_combination *comb;
 
-	init(argc, argv, "r:k:o:D:CM:vq");
+	init(argc, argv, "r:k:o:D:CM:dvq");
 	if (!options->forbidden.m || options->help || !(k = options->forbidden.k) || !(r = options->forbidden.r)) {
 		usage(argv[0]);
 	}
+	dubsuf = options->lambda == 2 ? "-double" : "";
 
 	K = complete_graph(k, r);
 
 	if (options->target_m == 1) {	/* There is only one graph unique graph on one edge less than the complete graph */
-		fp = open_outfile("%s/graphs-r=%d-k=%d-n=%d-m=%d.ei", options->graph_dir, r, k, k, K->m - 1);
+		fp = open_outfile("%s/graphs%s-r=%d-k=%d-n=%d-m=%d.ei", options->graph_dir, dubsuf, r, k, k, K->m - 1);
 		if (!fp) {
 			if (!options->quiet)
 				infomsg("NOTICE: No output file, exiting\n");
@@ -85,7 +86,7 @@ main(int argc, char *argv[]) {
 	} else if (options->target_m >= 2) {
 		m = K->m - options->target_m;
 
-		fp = open_outfile("%s/graphs-r=%d-k=%d-n=%d-m=%d.ei", options->graph_dir, r, k, k, m);
+		fp = open_outfile("%s/graphs%s-r=%d-k=%d-n=%d-m=%d.ei", options->graph_dir, dubsuf, r, k, k, m);
 
 		if (!fp) {	/* should only happen if output file exists and noclobber is set */
 			if (!options->quiet)
@@ -94,56 +95,13 @@ main(int argc, char *argv[]) {
 			return 0;
 		}
 
-		/* Dummy forbidden graph, unique K - e */
-		forbidden = Galloc(K->n, K->m - 1);
-		if (!forbidden) {
-			errmsg("CANTHAPPEN: Galloc(K->n, K->m - 1) == NULL\n");
-			assert(forbidden);
-		}
-
-		j = 0;
-		head = NULL;
-		/* M = options->target_m is the number of edges to remove from K */
-		/* Choose M-1 edges from K-e to construct the complement of every
-		   possible subgraph of K - e with M edges */
-		comb = gsl_combination_calloc(forbidden->m, options->target_m - 1);
-
-		do {
-			comp = Galloc(K->n, options->target_m);
-			if (!comp) {
-				errmsg("CANTHAPPEN: Galloc complement failed\n");
-				assert(comp);
-			}
-			for (i = 0; i < options->target_m - 1; i++)
-				comp->edges[i] = gsl_combination_get(comb, i);
-
-			/* add the edge not in K - e to all complemented subgraphs */
-			comp->edges[i] = forbidden->m;
-			comp->next = head;
-			head = comp;
-			j++;
-		} while (GSL_SUCCESS == gsl_combination_next(comb));
-
-		gsl_combination_free(comb);
-
-		head = isoreduce(head, K);
-
-		j = 0;
-		for (comp = head; comp; comp = comp->next) {
-			tmp = complement(comp, K);
-			if (!tmp) {
-				errmsg("CANTHAPPEN: complement(comp, K) == NULL\n");
-				writeg(comp, K, stderr);
-				assert(tmp);
-			}
-			writeg_ei(tmp, fp);
-			free_G(tmp);
-			j++;
-		}
+		/* Subgraphs of K on M = options->target_m fewer edges, found
+		   as the complements of the subgraphs of K with M edges */
+		B = subgraphs_on_m_edges(K, m);
+		writebatch_ei(B, fp);
 
 		f_close(fp);
-		cleanup(head);
-		free_G(forbidden);
+		free_batch(B);
 	} else {
 		if (options->target_m)
 			minm = K->m - options->target_m;
@@ -155,18 +113,18 @@ main(int argc, char *argv[]) {
 			if (options->target_m && m != minm)
 				break;
 
-			fp = open_outfile("%s/graphs-r=%d-k=%d-n=%d-m=%d.ei", options->graph_dir, r, k, k, m);
+			fp = open_outfile("%s/graphs%s-r=%d-k=%d-n=%d-m=%d.ei", options->graph_dir, dubsuf, r, k, k, m);
 			if (!fp) {	/* should only happen if output file exists and noclobber is set */
 				if (!options->quiet)
 					infomsg("NOTICE: No output file, skipping\n");
 				continue;
 			}
 
-			head = subgraphs_on_m_edges(K, m);
-			writegs_ei(head, fp);
+			B = subgraphs_on_m_edges(K, m);
+			writebatch_ei(B, fp);
 
 			f_close(fp);
-			cleanup(head);
+			free_batch(B);
 
 			if (minm != 1)
 				break;
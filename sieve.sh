@@ -65,7 +65,8 @@ else
 	TOSPLIT=$FILE1
 fi
 
-SPLIT=`./split.py $TOSPLIT`
+# the depth of the split for the run log, the files given are of depth $3
+SPLIT=`LPSPLITDEPTH=$((${3:-0} + 1)) ./split.py $TOSPLIT`
 RET=$?
 if [ $RET -ne 0 ];then
 	echo -e "${COLOR_ERROR}FATAL: Split failed${COLOR_RESET}"
@@ -133,20 +133,29 @@ solve() {
 
 int
 main(int argc, char *argv[]) {
-	int status, retval = 0;
+	int status, retval = 0, rows, error;
+	uint N = 0, M = 0, dummy;
 	GRBenv *env;
+	Runclock clock;
+	char *lp;
 
 	init(argc, argv, "f:T:t:");
 
 	if (options->help)
 		usage(argv[0]);
 
+	runclock_start(&clock);
 	init_gurobi(options->infile);
+	parse_infile(&dummy, &dummy, &dummy, &dummy, &N, &M, PFN_N | PFN_M);
 
 	env = GRBgetenv(model);
 	if (!env)
 		gurobi_err();
 
+	error = GRBgetintattr(model, GRB_INT_ATTR_NUMCONSTRS, &rows);
+	if (error)
+		gurobi_err();
+
 	status = solve();
 
 	switch (status) {
@@ -171,5 +180,11 @@ main(int argc, char *argv[]) {
 
 	}
 
+	lp = json_escape(options->infile);
+	runlog("sift", &clock, "\"lp\": \"%s\", \"N\": %u, \"M\": %u, \"vars\": %d, \"rows\": %d, \"status\": \"%s\"",
+	       lp, N, M, n_vars, rows, status == GRB_TIME_LIMIT ? "timeout" : status == GRB_OPTIMAL ? "feasible"
+	       : status == GRB_INFEASIBLE ? "infeasible" : "failed");
+	free(lp);
+
 	return retval;
 }
@@ -1,4 +1,5 @@
 #!/usr/bin/env python
+# -*- coding: utf-8 -*-
 
 # Copyright © 2011,2012,2013 Lars Lindqvist <lars.lindqvist at yandex.ru>
 #
@@ -20,7 +21,7 @@
 # FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
 # DEALINGS IN THE SOFTWARE.
 
-import gzip, os, re, string, itertools, sys
+import gzip, os, re, string, itertools, sys, time, socket, json, resource
 argv = sys.argv
 argc = len(argv)
 from subprocess import *
@@ -46,6 +47,7 @@ from subprocess import *
 #solve-r=4-k=6-n=9-m=108-N=10-M=176_no=0-010100111011111.lp
 
 n_splits = 1
+start = time.time()
 
 def errmsg(str):
 	sys.stderr.write(std + '\n')
@@ -68,6 +70,12 @@ else:
 edges = []
 edge_regex = re.compile(r'^( R[0-9]*:|) x[0-9]* = [01]\n$')
 edge_index = re.compile(r'(.*x| = [01]\n)')
+# lpsolve in direct mode saves the edges fixed by the graph as bounds,
+# x# = v, a binary x# >= 1 or x# <= 0 is as fixed
+bound_regex = re.compile(r'^ *x([0-9]+) *(=|>=|<=) *([01])(\.0*)? *\n$')
+
+def fixed_bound(m):
+	return m.group(2) == '=' or (m.group(2) == '>=') == (m.group(3) == '1')
 
 	
 def make_filenames():
@@ -107,17 +115,30 @@ if filename.endswith('.gz'):
 else:
 	cmd = Popen('cat "%s"' % filename,shell=True, stdout=PIPE)
 
-lastvar = 0
-added = False
-for line in cmd.stdout.readlines():
-	if(edge_regex.match(line)):
+lines = cmd.stdout.readlines()
+
+# The fixed edges, those in rows and those in the Bounds section, are
+# all needed before the new rows go in ahead of Bounds.
+in_bounds = False
+for line in lines:
+	if line in ('Bounds\n', 'Binaries\n', 'Generals\n', 'End\n'):
+		in_bounds = line == 'Bounds\n'
+	elif in_bounds:
+		x = bound_regex.match(line)
+		if x and fixed_bound(x) and int(x.group(1)) not in edges:
+			edges.append(int(x.group(1)))
+	elif(edge_regex.match(line)):
 		x = edge_index.split(line)
 		if len(x) != 5 or not x[2].isdigit():
 			errmsg("Can't continue, possibly bad LP constraint: %s" % line)
 			exit(1)
-		edges.append(int(x[2]))
+		if int(x[2]) not in edges:
+			edges.append(int(x[2]))
 
-	elif line in ('Bounds\n', 'Binaries\n') and not added:
+lastvar = 0
+added = False
+for line in lines:
+	if line in ('Bounds\n', 'Binaries\n') and not added:
 		added = True
 		found = 0
 		i = 0
@@ -145,6 +166,23 @@ for f in outfiles:
 	print f.name,
 	f.close()
 
+# Record for the run log, as those of the C programs, see runlog.py.
+# LPSPLITDEPTH is the depth of the new LPs, given by sieve.sh.
+runlog = os.environ.get('LPRUNLOG', '')
+if runlog not in ('', 'no'):
+	t = os.times()
+	level = re.search(r'-N=([0-9]+)-M=([0-9]+)', filename)
+	record = [('stage', 'split'), ('host', socket.gethostname()), ('pid', os.getpid()),
+		('time', time.strftime('%Y-%m-%dT%H:%M:%SZ', time.gmtime())),
+		('wall_s', round(time.time() - start, 3)), ('cpu_s', round(t[0] + t[1] + t[2] + t[3], 3)),
+		('maxrss_kib', resource.getrusage(resource.RUSAGE_SELF).ru_maxrss),
+		('lp', filename), ('N', int(level.group(1)) if level else 0), ('M', int(level.group(2)) if level else 0),
+		('depth', int(os.environ.get('LPSPLITDEPTH', '1'))), ('outputs', len(outfiles)),
+		('bytes', sum([os.path.getsize(f.name) for f in outfiles]))]
+	log = open(runlog, 'a')
+	log.write('{' + ', '.join(['"%s": %s' % (k, json.dumps(v)) for k, v in record]) + '}\n')
+	log.close()
+
 if lastvar != 0:
 	print lastvar - (len(edges) + n_splits)
 else:
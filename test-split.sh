@@ -0,0 +1,80 @@
+#!/bin/bash
+
+# Copyright © 2011,2012,2013 Lars Lindqvist <lars.lindqvist at yandex.ru>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the “Software”),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+# DEALINGS IN THE SOFTWARE.
+
+
+# Check that a model saved by lpsolve in direct mode, as it's left
+# when a limit is hit, is split by split.py into LPs that partition
+# its solutions.  Needs lpsolve, built with gurobi, and extsolve, which
+# solves the LPs.  Run from the directory of the programs, or by make
+# check.
+#
+# usage: ./test-split.sh [splits]
+
+SPLITS=${1:-2}
+DIR=$(mktemp -d ${TMPDIR:-/tmp}/test-split.XXXXXX)
+trap "rm -rf $DIR" EXIT
+
+fail() {
+	echo "$0: FAIL: $*" >&2
+	exit 1
+}
+
+# 3-graphs on 5 vertices and 9 edges, expanded to 6 vertices and 16
+# edges, which have a few hundred solutions
+./seed -q -r3 -k5 -M1 -D$DIR || fail "seed"
+LP=$(./lpsolve -q -S1 -M16 -D$DIR -f$DIR/graphs-r=3-k=5-n=5-m=9.ei | sed -n 's/^Unfinished: //p' | head -1)
+[ -n "$LP" ] || fail "lpsolve did not leave an unfinished LP"
+
+grep -q '^ *x[0-9]* *= *[01]' $LP || fail "no fixed edges x# = v in $LP"
+grep -q '^ *C[0-9]' $LP && fail "unnamed variables in $LP"
+
+# the parent's solutions not yet found, as the children's
+./extsolve -q -D$DIR -f$LP || fail "extsolve $LP"
+PARENT=$(sort $LP.soln | uniq | wc -l)
+[ $PARENT -gt 0 ] || fail "$LP has no solutions left"
+
+OUT=$(./split.py $LP $SPLITS) || fail "split.py $LP"
+CHILDREN=$(echo $OUT | wc -w)
+CHILDREN=$((CHILDREN - 1))
+[ $CHILDREN -eq $((1 << SPLITS)) ] || fail "split.py wrote $CHILDREN LPs"
+
+VARS=$(sed -n '/^Binaries/,/^End/p' $LP | grep -o 'x[0-9]*' | wc -l)
+FIXED=$(sed -n '/^Bounds/,/^Binaries/p' $LP | grep -c '^ *x[0-9]* *= *[01]')
+FREE=$(echo $OUT | awk '{print $NF}')
+[ $FREE -eq $((VARS - FIXED - SPLITS)) ] || fail "split.py says $FREE free variables, not $((VARS - FIXED - SPLITS))"
+
+TOTAL=0
+for CHILD in $(echo $OUT | awk '{$NF = ""; print}'); do
+	# the new rows are free variables of the parent
+	for V in $(diff $LP $CHILD | sed -n 's/^> *\(x[0-9]*\) = [01]$/\1/p'); do
+		grep -q "^ *$V = " $LP && fail "$CHILD splits on fixed $V"
+		sed -n '/^Binaries/,/^End/p' $LP | grep -qw $V || fail "$CHILD splits on unknown $V"
+	done
+	./extsolve -q -D$DIR -f$CHILD || fail "extsolve $CHILD"
+	TOTAL=$((TOTAL + $(wc -l < $CHILD.soln)))
+	cat $CHILD.soln >> $DIR/children
+done
+
+[ $TOTAL -eq $PARENT ] || fail "the children have $TOTAL solutions, the parent $PARENT"
+sort $DIR/children | uniq | cmp -s - <(sort $LP.soln | uniq) || fail "the children's solutions are not the parent's"
+
+echo "$0: OK, $PARENT solutions in $CHILDREN LPs"
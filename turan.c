@@ -0,0 +1,765 @@
+/*
+ * Copyright © 2011,2012,2013 Lars Lindqvist <lars.lindqvist at yandex.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Driver for a whole run, in place of turan.sh, expand_graphs-lp.sh
+   and expand_graphs-lp-solver.sh.  The same programs are run, but as
+   jobs of a dependency graph on a pool of workers, rather than one
+   at a time from recursive scripts.
+
+   A level is the set of graphs on n vertices and m edges, the file
+   graphs-r=#-k=#-n=#-m=#.ei, or graphs-double-r=#-... with -d.
+   Level (N, M) is made by expanding the graphs of the levels
+   (N-1, m) for minm <= m <= M, minm = M - floor(M r / N), each file
+   by one job of lpsolve -M.  As in the
+   scripts, the level (N-1, minm) is made first if it is missing, but
+   the levels that already exist are expanded while it is made.  The
+   LPs lpsolve leaves unfinished are solved on their own, and split
+   in two and sieved if a limit is hit again.  All these jobs may run
+   at once.  Every solution file is merged by isoreduce -I into the
+   stage of the level as soon as it is written, one at a time, and
+   when the last job is done the stage is the level's file.  The level
+   is then recorded in the catalogue of the graph directory, as
+   complete or as empty, and whether a level is done is taken from
+   there, see catalog.c.
+
+   Levels are then tried as turan.sh does, for every N the largest M
+   first, until there are graphs. */
+
+#include "util.h"
+#include "catalog.h"
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <dirent.h>
+
+static void
+usage(const char *prog) {
+	fprintf(stdout,
+		"usage: %s -r# -k# -N# [-d] [-t#] [-B#] [-T#] [-q] [-D directory]\n"
+		"	mandatory arguments\n"
+		"	 -r, graph uniformity\n"
+		"	 -k, vertices in forbidden graph\n"
+		"	 -N, largest number of vertices\n"
+		"	optional arguments\n"
+		"	 -d, double coverings, as turan-double.sh\n"
+		"	 -t, number of cpus to keep busy, default one per cpu.  An\n"
+		"	     expansion takes $LPJOBS * $LPTHREADS of them, solving an\n"
+		"	     LP $LPTHREADS, any other job one\n"
+		"	 -B, memory limit in MiB of each job\n"
+		"	 -T, cpu time limit in minutes of each job\n"
+		"	 -q, quiet, don't print the jobs as they are started\n"
+		"	misc: The variables of ~/.lpconfig are taken from the environment,\n"
+		"	      with the same defaults as in the scripts.  Models are always\n"
+		"	      built by lpsolve, as with LPDIRECT=yes.\n"
+		"	      Graph directory will be choosen by:\n"
+		"	      1) command line argument -D\n"
+		"	      2) environment variable $GRAPH_DIR\n"
+		"	      3) compile time definition OUTDIR=" OUTDIR "\n", prog);
+
+	exit(EXIT_FAILURE);
+}
+
+enum { SEED, EXPAND, SOLVE, SPLIT, SIEVE, MERGE };
+enum { L_RUNNING, L_GRAPHS, L_EMPTY, L_FAILED };
+
+typedef struct Level Level;
+struct Level {
+	uint n, m;
+	int state;
+	uint jobs;		/* jobs queued or running */
+	uint waiting;		/* levels to be made before this one */
+	uint unsolved;		/* LPs left by LPSTOP=yes */
+	Level *parent;		/* level waiting for this one */
+	char **soln;		/* solution files to merge */
+	uint nsoln;
+	uint soln_size;
+	int merging;		/* a merge is queued or running */
+};
+
+typedef struct Job Job;
+struct Job {
+	int kind;
+	Level *L;
+	char **argv;
+	uint argc;
+	char *capture;		/* stdout goes to this file, if not NULL */
+	uint slots;
+	pid_t pid;
+	Job *next;
+};
+
+static uint r, k, lambda;
+static const char *solver;
+static char limits[8][32];	/* arguments of the solver */
+static uint nlimits;
+static uint lp_jobs, lp_threads, lp_stop, symmetry, cubes;
+static Job *queue, *queue_tail, *running;
+static uint slots, slots_used, job_no;
+static int failed;
+
+static void level_done(Level *);
+
+static uint
+env_uint(const char *name, uint def) {
+	const char *s = getenv(name);
+
+	return s && *s ? (uint) atoi(s) : def;
+}
+
+static int
+env_is(const char *name, const char *val) {
+	const char *s = getenv(name);
+
+	return s && !strcmp(s, val);
+}
+
+static char *
+path_of(const char *fmt, ...) {
+	va_list args;
+	char *p;
+
+	p = g_malloc(PATH_MAX);
+	va_start(args, fmt);
+	vsnprintf(p, PATH_MAX, fmt, args);
+	va_end(args);
+	return p;
+}
+
+static char *
+level_path(uint n, uint m) {
+	return path_of("%s/graphs%s-r=%u-k=%u-n=%u-m=%u.ei", options->graph_dir,
+		       lambda == 2 ? "-double" : "", r, k, n, m);
+}
+
+/* The solutions of a level are merged into this, its store is the
+   same with .store appended */
+static char *
+stage_path(uint n, uint m) {
+	return path_of("%s/_helpers/merge%s-r=%u-k=%u-n=%u-m=%u.ei", options->graph_dir,
+		       lambda == 2 ? "-double" : "", r, k, n, m);
+}
+
+/* CAT_COMPLETE, CAT_EMPTY or CAT_UNKNOWN */
+static int
+level_status(uint n, uint m) {
+	char *path = level_path(n, m);
+	int ret = catalog_done(r, k, lambda, n, m, path);
+
+	free(path);
+	return ret;
+}
+
+static Job *
+job_new(int kind, Level * L, uint slots) {
+	Job *J;
+
+	J = g_calloc(1, sizeof(Job));
+	J->kind = kind;
+	J->L = L;
+	J->slots = slots;
+	J->argv = g_calloc(32, sizeof(char *));
+	L->jobs++;
+	return J;
+}
+
+/* Append an argument, "" is skipped so that optional flags can be
+   given as empty strings */
+static void
+job_arg(Job * J, const char *fmt, ...) {
+	va_list args;
+	char buf[PATH_MAX];
+
+	va_start(args, fmt);
+	vsnprintf(buf, PATH_MAX, fmt, args);
+	va_end(args);
+	if (!*buf)
+		return;
+	if (J->argc == 31) {
+		errmsg("FATAL: too many arguments to %s\n", J->argv[0]);
+		exit(EXIT_FAILURE);
+	}
+	J->argv[J->argc++] = strdup(buf);
+}
+
+static void
+job_limits(Job * J) {
+	uint i;
+
+	for (i = 0; i < nlimits; i++)
+		job_arg(J, "%s", limits[i]);
+}
+
+static void
+job_free(Job * J) {
+	uint i;
+
+	for (i = 0; i < J->argc; i++)
+		free(J->argv[i]);
+	free(J->argv);
+	free(J->capture);
+	free(J);
+}
+
+static void
+enqueue(Job * J) {
+	J->next = NULL;
+	if (queue_tail)
+		queue_tail->next = J;
+	else
+		queue = J;
+	queue_tail = J;
+}
+
+/* Limits and redirections of a job, in the child */
+static void
+child_setup(Job * J) {
+	struct rlimit rl;
+	int fd;
+
+	if (options->mem_limit) {
+		rl.rlim_cur = rl.rlim_max = (rlim_t) options->mem_limit << 20;
+		if (setrlimit(RLIMIT_AS, &rl))
+			errmsg("WARNING: setrlimit: %s\n", strerror(errno));
+	}
+	if (options->timelimit) {
+		rl.rlim_cur = rl.rlim_max = options->timelimit;
+		if (setrlimit(RLIMIT_CPU, &rl))
+			errmsg("WARNING: setrlimit: %s\n", strerror(errno));
+	}
+	if (J->capture) {
+		fd = open(J->capture, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0 || dup2(fd, STDOUT_FILENO) < 0) {
+			errmsg("FATAL: %s: %s\n", J->capture, strerror(errno));
+			_exit(127);
+		}
+		close(fd);
+	}
+}
+
+static void
+start(Job * J) {
+	uint i;
+
+	if (!options->quiet) {
+		fprintf(stdout, "%s", J->argv[0]);
+		for (i = 1; i < J->argc; i++)
+			fprintf(stdout, " %s", J->argv[i]);
+		fputc('\n', stdout);
+	}
+	fflush(stdout);
+	fflush(stderr);
+
+	J->pid = fork();
+	if (J->pid < 0) {
+		errmsg("FATAL: fork: %s\n", strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if (!J->pid) {
+		child_setup(J);
+		execv(J->argv[0], J->argv);
+		errmsg("FATAL: %s: %s\n", J->argv[0], strerror(errno));
+		_exit(127);
+	}
+
+	J->next = running;
+	running = J;
+	slots_used += J->slots;
+}
+
+/* Start queued jobs while there are free cpus, a job larger than the
+   pool is started alone */
+static void
+schedule() {
+	Job *J;
+
+	while (!failed && (J = queue) && (slots_used + J->slots <= slots || !slots_used)) {
+		queue = J->next;
+		if (!queue)
+			queue_tail = NULL;
+		start(J);
+	}
+}
+
+/* Merge the next solution file of L, if none is being merged */
+static void
+queue_merge(Level * L) {
+	char *stage;
+	Job *J;
+
+	if (L->merging || !L->nsoln)
+		return;
+	L->merging = 1;
+
+	stage = stage_path(L->n, L->m);
+	J = job_new(MERGE, L, 1);
+	job_arg(J, "./isoreduce");
+	job_arg(J, "-q");
+	job_arg(J, "-a");
+	job_arg(J, "-I%s.store", stage);
+	job_arg(J, "-r%u", r);
+	job_arg(J, "-k%u", k);
+	job_arg(J, "-n%u", L->n);
+	job_arg(J, "-m%u", L->m);
+	job_arg(J, "-o%s", stage);
+	job_arg(J, "-f%s", L->soln[--L->nsoln]);
+	free(L->soln[L->nsoln]);
+	free(stage);
+	enqueue(J);
+}
+
+static void
+add_soln(Level * L, const char *file) {
+	struct stat st;
+	char *dest;
+
+	if (stat(file, &st) || !st.st_size) {
+		unlink(file);
+		return;
+	}
+	dest = path_of("%s/_solutions/%s", options->graph_dir, strrchr(file, '/') ? strrchr(file, '/') + 1 : file);
+	if (rename(file, dest)) {
+		errmsg("FATAL: rename %s: %s\n", file, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if (L->nsoln == L->soln_size) {
+		L->soln_size = L->soln_size ? 2 * L->soln_size : 64;
+		L->soln = g_realloc(L->soln, L->soln_size * sizeof(char *));
+	}
+	L->soln[L->nsoln++] = dest;
+	queue_merge(L);
+}
+
+static void
+queue_expand(Level * L, uint m) {
+	Job *J;
+
+	J = job_new(EXPAND, L, lp_jobs * (strcmp(solver, "./extsolve") ? lp_threads : 1));
+	job_arg(J, "%s", solver);
+	job_arg(J, "-q");
+	job_arg(J, lambda == 2 ? "-d" : "");
+	job_arg(J, symmetry ? "-y" : "");
+	job_arg(J, "-j%u", lp_jobs);
+	job_limits(J);
+	job_arg(J, "-M%u", L->m);
+	job_arg(J, "-D%s", options->graph_dir);
+	job_arg(J, "-f%s/graphs%s-r=%u-k=%u-n=%u-m=%u.ei", options->graph_dir,
+		lambda == 2 ? "-double" : "", r, k, L->n - 1, m);
+	J->capture = path_of("%s/_helpers/turan-%u.out", options->graph_dir, job_no++);
+	enqueue(J);
+}
+
+static void
+queue_solve(Level * L, const char *lp) {
+	Job *J;
+
+	/* with cubes an LP is solved by -j workers */
+	J = job_new(SOLVE, L, (cubes ? lp_jobs : 1) * lp_threads);
+	job_arg(J, "%s", solver);
+	job_arg(J, "-aq");
+	if (cubes)
+		job_arg(J, "-j%u", lp_jobs);
+	job_limits(J);
+	job_arg(J, "-o%s.soln", lp);
+	job_arg(J, "%s", lp);
+	enqueue(J);
+}
+
+/* Start making L, see the top of the file.  The caller finishes L
+   if no jobs were needed. */
+static void
+level_start(Level * L) {
+	Level *P;
+	Job *J;
+	uint m, minm;
+	int status;
+
+	L->state = L_RUNNING;
+	switch (level_status(L->n, L->m)) {
+	case CAT_COMPLETE:
+		L->state = L_GRAPHS;
+		return;
+	case CAT_EMPTY:
+		L->state = L_EMPTY;
+		return;
+	}
+
+	if (L->n == k) {
+		J = job_new(SEED, L, 1);
+		job_arg(J, "./seed");
+		job_arg(J, "-C");
+		job_arg(J, lambda == 2 ? "-d" : "");
+		job_arg(J, "-r%u", r);
+		job_arg(J, "-k%u", k);
+		job_arg(J, "-M%u", nCk(k, r) - L->m);
+		job_arg(J, "-D%s", options->graph_dir);
+		enqueue(J);
+		return;
+	}
+
+	/* Held until every expansion of L is queued */
+	L->waiting++;
+	minm = L->m - L->m * r / L->n;
+	for (m = L->m; m + 1 > minm; m--) {
+		status = level_status(L->n - 1, m);
+		if (status == CAT_COMPLETE) {
+			queue_expand(L, m);
+		} else if (m == minm && status != CAT_EMPTY) {
+			if (!options->quiet)
+				infomsg("We need graphs on %u vertices and %u edges\n", L->n - 1, m);
+			P = g_calloc(1, sizeof(Level));
+			P->n = L->n - 1;
+			P->m = m;
+			P->parent = L;
+			L->waiting++;
+			level_start(P);
+			if (!P->waiting && !P->jobs)
+				level_done(P);
+		}
+	}
+	L->waiting--;
+}
+
+/* All expansions and merges of L are done, the stage is its file */
+static void
+level_install(Level * L) {
+	char *stage, *path;
+
+	stage = stage_path(L->n, L->m);
+	path = level_path(L->n, L->m);
+	if (!access(stage, F_OK) && rename(stage, path)) {
+		errmsg("FATAL: rename %s: %s\n", stage, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	free(path);
+	path = path_of("%s.store", stage);
+	unlink(path);
+	free(path);
+	free(stage);
+}
+
+/* L has no jobs or levels left to wait for, move it on and tell the
+   level waiting for it */
+static void
+level_done(Level * L) {
+	Level *Q = L->parent;
+	struct stat st;
+	char *path;
+
+	if (failed)
+		L->state = L_FAILED;
+	if (L->state == L_RUNNING && L->unsolved) {
+		errmsg("WARNING: %u unsolved LPs remain for N=%u M=%u%s\n", L->unsolved, L->n, L->m,
+		       lp_stop ? ", as LPSTOP=yes" : "");
+		L->state = L_FAILED;
+	}
+	if (L->state == L_RUNNING) {
+		if (L->n > k)
+			level_install(L);
+
+		path = level_path(L->n, L->m);
+		if (!stat(path, &st) && !st.st_size)
+			unlink(path);
+		if (!stat(path, &st)) {
+			L->state = L_GRAPHS;
+			if (!options->quiet)
+				infomsg("All non-isomorphic K_%u-free %u-graphs on %u vertices and %u edges have been found\n",
+					k, r, L->n, L->m);
+		} else {
+			L->state = L_EMPTY;
+			if (!options->quiet)
+				infomsg("No expansions were possible for N=%u M=%u\n", L->n, L->m);
+		}
+		catalog_record(r, k, lambda, L->n, L->m, L->state == L_GRAPHS ? path : NULL, "turan");
+		free(path);
+	}
+	if (L->state == L_FAILED)
+		failed = 1;
+
+	if (!Q)
+		return;
+	Q->waiting--;
+	if (L->state == L_GRAPHS)
+		queue_expand(Q, L->m);
+	free(L->soln);
+	free(L);
+	if (!Q->waiting && !Q->jobs)
+		level_done(Q);
+}
+
+/* Lines `Solved: file' and `Unfinished: file' of lpsolve -M */
+static void
+expand_done(Job * J) {
+	char line[PATH_MAX + 32], *file;
+	FILE *fp;
+
+	fp = f_open(J->capture, "r");
+	while (fgets(line, sizeof(line), fp)) {
+		line[strcspn(line, "\n")] = '\0';
+		if (!strncmp(line, "Solved: ", 8)) {
+			add_soln(J->L, line + 8);
+		} else if (!strncmp(line, "Unfinished: ", 12)) {
+			file = line + 12;
+			if (!options->quiet)
+				infomsg("Limit reached for %s\n", file);
+			queue_solve(J->L, file);
+		}
+	}
+	f_close(fp);
+	unlink(J->capture);
+}
+
+/* The output of split.py is the two new files and how many edges are
+   left free in them */
+static void
+split_done(Job * J) {
+	char a[PATH_MAX], b[PATH_MAX];
+	Job *S;
+	FILE *fp;
+
+	fp = f_open(J->capture, "r");
+	if (fscanf(fp, "%4095s %4095s", a, b) != 2) {
+		errmsg("FATAL: Split of %s failed\n", J->argv[1]);
+		failed = 1;
+	}
+	f_close(fp);
+	unlink(J->capture);
+	unlink(J->argv[1]);
+	if (failed)
+		return;
+
+	S = job_new(SIEVE, J->L, lp_threads);
+	job_arg(S, "./sieve.sh");
+	job_arg(S, "%s", a);
+	job_arg(S, "%s", b);
+	job_arg(S, "1");
+	enqueue(S);
+}
+
+static void
+job_done(Job * J, int status) {
+	Level *L = J->L;
+	Job *S;
+	char *soln;
+	int ret;
+
+	ret = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+	if (WIFSIGNALED(status))
+		errmsg("ERROR: %s killed by signal %d\n", J->argv[0], WTERMSIG(status));
+
+	switch (J->kind) {
+	case EXPAND:
+		if (ret == 0 || ret == 2)
+			expand_done(J);
+		else
+			failed = 1;
+		break;
+
+	case SOLVE:
+		soln = path_of("%s.soln", J->argv[J->argc - 1]);
+		if (ret == 0 || ret == 2)
+			add_soln(L, soln);
+		free(soln);
+		if (ret == 0) {
+			unlink(J->argv[J->argc - 1]);
+		} else if (ret == 2) {
+			if (!options->quiet)
+				infomsg("Limit reached for %s, splitting\n", J->argv[J->argc - 1]);
+			S = job_new(SPLIT, L, 1);
+			job_arg(S, "./split.py");
+			job_arg(S, "%s", J->argv[J->argc - 1]);
+			S->capture = path_of("%s/_helpers/turan-%u.out", options->graph_dir, job_no++);
+			enqueue(S);
+		} else {
+			failed = 1;
+		}
+		break;
+
+	case SPLIT:
+		if (ret == 0)
+			split_done(J);
+		else
+			failed = 1;
+		break;
+
+	case MERGE:
+		if (ret) {
+			failed = 1;
+		} else {
+			unlink(J->argv[J->argc - 1] + 2);
+			L->merging = 0;
+			queue_merge(L);
+		}
+		break;
+
+	case SIEVE:
+		if (ret) {
+			failed = 1;
+		} else if (lp_stop) {
+			L->unsolved += 2;
+		} else {
+			queue_solve(L, J->argv[1]);
+			queue_solve(L, J->argv[2]);
+		}
+		break;
+
+	default:
+		if (ret)
+			failed = 1;
+	}
+
+	if (ret && failed)
+		errmsg("ERROR: %s returned %d\n", J->argv[0], ret);
+	if (failed)
+		L->state = L_FAILED;
+
+	L->jobs--;
+	if (!L->jobs && !L->waiting)
+		level_done(L);
+}
+
+/* Run jobs until L is made */
+static void
+run(Level * L) {
+	Job *J, **p;
+	pid_t pid;
+	int status;
+
+	level_start(L);
+	if (!L->waiting && !L->jobs)
+		level_done(L);
+	while (running || (!failed && queue)) {
+		schedule();
+		if ((pid = wait(&status)) < 0) {
+			errmsg("FATAL: wait: %s\n", strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		for (p = &running; *p && (*p)->pid != pid; p = &(*p)->next) ;
+		if (!(J = *p))
+			continue;
+		*p = J->next;
+		slots_used -= J->slots;
+		job_done(J, status);
+		job_free(J);
+	}
+	if (failed || L->state == L_FAILED) {
+		errmsg("FATAL: could not make the graphs on %u vertices and %u edges\n", L->n, L->m);
+		exit(EXIT_FAILURE);
+	}
+	free(L->soln);
+}
+
+/* Largest n, or the largest m of n if n is not 0, of the graph files
+   in the graph directory, 0 if there are none */
+static uint
+largest(uint n) {
+	DIR *dir;
+	struct dirent *de;
+	const char *fmt;
+	uint fr, fk, fn, fm, max = 0;
+
+	fmt = lambda == 2 ? "graphs-double-r=%u-k=%u-n=%u-m=%u.ei" : "graphs-r=%u-k=%u-n=%u-m=%u.ei";
+
+	if (!(dir = opendir(options->graph_dir))) {
+		errmsg("FATAL: %s: %s\n", options->graph_dir, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	while ((de = readdir(dir)))
+		if (sscanf(de->d_name, fmt, &fr, &fk, &fn, &fm) == 4
+		    && fr == r && fk == k && (n ? fn == n && fm > max : fn > max)
+		    && level_status(fn, fm) == CAT_COMPLETE)
+			max = n ? fm : fn;
+	closedir(dir);
+	return max;
+}
+
+int
+main(int argc, char *argv[]) {
+	Level L;
+	uint N, M, maxm;
+	char *dir;
+
+	init(argc, argv, "qvr:k:N:dt:B:T:D:");
+
+	r = options->forbidden.r;
+	k = options->forbidden.k;
+	if (options->help || !r || !k || !options->target_n)
+		usage(argv[0]);
+	lambda = options->lambda;
+
+	/* As the scripts have it */
+	setenv("LD_LIBRARY_PATH", "./lib", 1);
+	setenv("GRAPH_DIR", options->graph_dir, 1);
+	dir = path_of("%s/runlog", options->graph_dir);
+	setenv("LPRUNLOG", dir, 0);
+	free(dir);
+	lp_jobs = env_uint("LPJOBS", 1);
+	lp_threads = env_uint("LPTHREADS", 1);
+	lp_stop = env_is("LPSTOP", "yes");
+	symmetry = !env_is("LPSYMMETRY", "no");
+	if (env_is("LPSOLVER", "native")) {
+		solver = "./extsolve";
+	} else {
+		solver = "./lpsolve";
+		snprintf(limits[nlimits++], 32, "-T%u", env_uint("LPTIMEOUT", 120));
+		snprintf(limits[nlimits++], 32, "-t%u", lp_threads);
+		snprintf(limits[nlimits++], 32, "-s%u", env_uint("LPMINSOLN", 0));
+		snprintf(limits[nlimits++], 32, "-S%u", env_uint("LPMAXSOLN", 1000));
+		snprintf(limits[nlimits++], 32, "-w%u", env_uint("LPWRTBACK", 0));
+		if (env_is("LPENUM", "yes"))
+			snprintf(limits[nlimits++], 32, "-e");
+		cubes = env_uint("LPCUBES", 0);
+		if (cubes)
+			snprintf(limits[nlimits++], 32, "-c%u", cubes);
+	}
+	slots = nthreads();
+
+	dir = path_of("%s/_helpers", options->graph_dir);
+	mkdir(options->graph_dir, 0755);
+	mkdir(dir, 0755);
+	free(dir);
+	dir = path_of("%s/_solutions", options->graph_dir);
+	mkdir(dir, 0755);
+	free(dir);
+
+	/* The forbidden graph minus lambda edges, and the levels below it
+	   as they are needed */
+	memset(&L, 0, sizeof(Level));
+	L.n = k;
+	L.m = nCk(k, r) - lambda;
+	run(&L);
+
+	for (N = largest(0) + 1; N <= options->target_n; N++) {
+		maxm = largest(N - 1);
+		if (!maxm)
+			break;
+		for (M = N * maxm / (N - r); M > 0; M--) {
+			memset(&L, 0, sizeof(Level));
+			L.n = N;
+			L.m = M;
+			run(&L);
+			if (L.state == L_GRAPHS)
+				break;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
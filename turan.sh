@@ -34,6 +34,7 @@ fi
 
 if `basename $0 | grep -q double`;then
 	DUBSUF="-double"
+	DOUBLE="-d"
 	SEEDSIZE=2
 else
 	DUBSUF=""
@@ -48,14 +49,14 @@ if [ ! -d $GRAPH_DIR ];then
 fi
 
 # initialize forbidden graph minus one edge
-echo "./seed -C -r$r -k$k -M${SEEDSIZE}"
-./seed -C -r$r -k$k -M${SEEDSIZE}
+echo "./seed -C $DOUBLE -r$r -k$k -M${SEEDSIZE}"
+./seed -C $DOUBLE -r$r -k$k -M${SEEDSIZE}
 if [ $? -ne 0 ];then
 	echo -e "${COLOR_ERROR}FATAL: seed did not exit cleanly ${COLOR_RESET}"
 	exit 1
 fi
 
-MINN=$(ls $GRAPH_DIR/graphs-r=$r-k=$k-n=*-m=*.ei 2>/dev/null \
+MINN=$(ls $GRAPH_DIR/graphs${DUBSUF}-r=$r-k=$k-n=*-m=*.ei 2>/dev/null \
 	| gawk -vn=$k -F'-n=' '{
 	if(int($2) > n) {
 		n = int($2);
@@ -69,7 +70,7 @@ for N in `seq $MINN $MAXN`;do
 	n=$((N-1))
 
 	# find upper bound, based on the largest graph available on N-1 vertices
-	MAXM=$(ls $GRAPH_DIR/graphs-r=$r-k=$k-n=$n-m=*.ei 2>/dev/null \
+	MAXM=$(ls $GRAPH_DIR/graphs${DUBSUF}-r=$r-k=$k-n=$n-m=*.ei 2>/dev/null \
 	| gawk -vN=$N -vr=$r -F'-m=' '{
 		if(int($2) > m) {
 			m = int($2);
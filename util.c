@@ -22,6 +22,9 @@
 
 #include "graph.h"
 #include "util.h"
+#include <fcntl.h>
+#include <time.h>
+#include <sys/resource.h>
 
 options_t _options;
 const options_t *options = (const options_t *)&_options;
@@ -71,10 +74,20 @@ open_infile() {
 		return f_open(_options.infile, "r");
 }
 
+#ifdef COUNT_ALLOCS
+/* Calls of g_malloc(), g_calloc() and g_realloc(), only in bench's
+   build, see the Makefile */
+volatile ulong g_allocs;
+#define COUNT_ALLOC() __sync_fetch_and_add(&g_allocs, 1)
+#else
+#define COUNT_ALLOC()
+#endif
+
 void *
 g_malloc(size_t size) {
 	void *ret = NULL;
 
+	COUNT_ALLOC();
 	ret = malloc(size);
 	if (ret == NULL) {
 		errmsg("FATAL: could not allocate memory\n");
@@ -87,6 +100,7 @@ void *
 g_calloc(size_t nmemb, size_t size) {
 	void *ret = NULL;
 
+	COUNT_ALLOC();
 	ret = calloc(nmemb, size);
 	if (ret == NULL) {
 		errmsg("FATAL: could not allocate memory\n");
@@ -97,6 +111,7 @@ g_calloc(size_t nmemb, size_t size) {
 
 void *
 g_realloc(void *ret, size_t size) {
+	COUNT_ALLOC();
 	ret = realloc(ret, size);
 	if (ret == NULL) {
 		errmsg("FATAL: could not allocate memory\n");
@@ -160,6 +175,117 @@ open_outfile(const char *fmt, ...) {
 	return f_open(_options.outfile, _options.append ? "a" : "w");
 }
 
+static double
+seconds(struct timeval *tv) {
+	return tv->tv_sec + tv->tv_usec / 1e6;
+}
+
+static void
+clock_now(double *wall, double *cpu, long *maxrss) {
+	struct timespec ts;
+	struct rusage ru;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	*wall = ts.tv_sec + ts.tv_nsec / 1e9;
+	getrusage(RUSAGE_SELF, &ru);
+	*cpu = seconds(&ru.ru_utime) + seconds(&ru.ru_stime);
+	*maxrss = ru.ru_maxrss;
+}
+
+void
+runclock_start(Runclock * c) {
+	long maxrss;
+
+	clock_now(&c->wall, &c->cpu, &maxrss);
+	c->shared = 0;
+}
+
+/* s as the inside of a JSON string, to be freed by the caller */
+char *
+json_escape(const char *s) {
+	char *e, *p;
+
+	p = e = g_malloc(6 * strlen(s) + 1);
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\') {
+			*p++ = '\\';
+			*p++ = *s;
+		} else if ((unsigned char)*s < 0x20) {
+			p += sprintf(p, "\\u%04x", (unsigned char)*s);
+		} else {
+			*p++ = *s;
+		}
+	}
+	*p = '\0';
+	return e;
+}
+
+/* Append a record to the run log $LPRUNLOG, one JSON object per line,
+   see runlog.py.  The fields of the caller, fmt, come after the stage,
+   the time since c was started, the cpu time of the process since then
+   and the peak resident size of the process.  If c is shared, as with
+   -j, the cpu time and size are of all the runs of the process, and
+   the record says so.  Strings in fmt must be json_escape()d.  Nothing
+   is logged if $LPRUNLOG is unset, empty or `no'. */
+void
+runlog(const char *stage, Runclock * c, const char *fmt, ...) {
+	const char *path = getenv("LPRUNLOG");
+	char line[4096], host[256], date[32], *h;
+	double wall, cpu;
+	long maxrss;
+	struct tm tm;
+	time_t now;
+	va_list args;
+	size_t len;
+	int fd;
+
+	if (!path || !*path || !strcmp(path, "no"))
+		return;
+
+	clock_now(&wall, &cpu, &maxrss);
+	if (gethostname(host, sizeof(host)))
+		strcpy(host, "unknown");
+	host[sizeof(host) - 1] = '\0';
+	now = time(NULL);
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime_r(&now, &tm));
+
+	h = json_escape(host);
+	len = snprintf(line, sizeof(line), "{\"stage\": \"%s\", \"host\": \"%s\", \"pid\": %d, \"time\": \"%s\", "
+		       "\"wall_s\": %.3f, \"cpu_s\": %.3f, \"maxrss_kib\": %ld%s", stage, h, (int)getpid(), date,
+		       wall - c->wall, cpu - c->cpu, maxrss, c->shared ? ", \"shared\": true" : "");
+	free(h);
+	if (len < sizeof(line) && fmt && *fmt) {
+		len += snprintf(line + len, sizeof(line) - len, ", ");
+		va_start(args, fmt);
+		if (len < sizeof(line))
+			len += vsnprintf(line + len, sizeof(line) - len, fmt, args);
+		va_end(args);
+	}
+	if (len < sizeof(line))
+		len += snprintf(line + len, sizeof(line) - len, "}\n");
+	if (len >= sizeof(line)) {
+		errmsg("WARNING: run log record of %s too long\n", stage);
+		return;
+	}
+
+	/* one write, records of processes sharing the log don't mix */
+	fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+	if (fd < 0 || write(fd, line, len) != (ssize_t) len)
+		errmsg("WARNING: run log %s: %s\n", path, strerror(errno));
+	if (fd >= 0)
+		close(fd);
+}
+
+/* Bytes in the file of fp, after writing out what is buffered */
+long
+file_bytes(FILE * fp) {
+	struct stat st;
+
+	if (fflush(fp) || fstat(fileno(fp), &st) || !S_ISREG(st.st_mode))
+		return 0;
+	return st.st_size;
+}
+
 /* read one line from file, regardless of length */
 char *
 read_line(FILE * fp) {
@@ -188,17 +314,98 @@ read_line(FILE * fp) {
 	return buf;
 }
 
+/* Number of worker threads, -t or else one per online cpu */
+uint
+nthreads() {
+	long n;
+
+	if (options->threads > 0)
+		return options->threads;
+	n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (uint) n : 1;
+}
+
+typedef struct {
+	void (*fn)(void *, uint);
+	void *arg;
+	uint n;
+	uint next;
+	pthread_mutex_t lock;
+} parallel_t;
+
+static void *
+parallel_worker(void *p) {
+	parallel_t *P = p;
+	uint i;
+
+	for (;;) {
+		pthread_mutex_lock(&P->lock);
+		i = P->next++;
+		pthread_mutex_unlock(&P->lock);
+		if (i >= P->n)
+			break;
+		P->fn(P->arg, i);
+	}
+	return NULL;
+}
+
+/* Call fn(arg, i) for every i in [0, n), spread over nthreads()
+   threads.  Work is handed out one i at a time, so fn should do
+   a reasonable amount of work per call. */
+void
+parallel_for(uint n, void (*fn)(void *, uint), void *arg) {
+	parallel_t P;
+	pthread_t *tids;
+	uint i, t;
+
+	t = nthreads();
+	if (t > n)
+		t = n;
+	if (t <= 1) {
+		for (i = 0; i < n; i++)
+			fn(arg, i);
+		return;
+	}
+
+	P.fn = fn;
+	P.arg = arg;
+	P.n = n;
+	P.next = 0;
+	pthread_mutex_init(&P.lock, NULL);
+
+	tids = g_malloc(t * sizeof(pthread_t));
+	for (i = 0; i < t; i++)
+		if ((errno = pthread_create(tids + i, NULL, parallel_worker, &P))) {
+			errmsg("FATAL: pthread_create: %s\n", strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+	for (i = 0; i < t; i++)
+		pthread_join(tids[i], NULL);
+
+	pthread_mutex_destroy(&P.lock);
+	free(tids);
+}
+
 void
 init(int argc, char *argv[], const char *args) {
 	int opt;
 	int err;
 
 	_options.infile = NULL;
+	_options.store = NULL;
 	_options.graph_dir = NULL;
 	_options.presolve = 1;
 	_options.use_default_outfile = 1;
 	_options.timelimit = 0;
 	_options.threads = 0;
+	_options.mem_limit = 0;
+	_options.binary = 0;
+	_options.lambda = 1;
+	_options.reduce = 0;
+	_options.jobs = 1;
+	_options.enumerate = 0;
+	_options.symmetry = 0;
+	_options.cubes = 0;
 	_options.forbidden.r =
 	 _options.solutions_min =
 	 _options.solutions_max =
@@ -270,6 +477,33 @@ init(int argc, char *argv[], const char *args) {
 		case 'p':
 			_options.presolve = 0;
 			break;
+		case 'B':
+			_options.mem_limit = atoi(optarg);
+			break;
+		case 'I':
+			_options.store = optarg;
+			break;
+		case 'b':
+			_options.binary = 1;
+			break;
+		case 'd':
+			_options.lambda = 2;
+			break;
+		case 'R':
+			_options.reduce = 1;
+			break;
+		case 'j':
+			_options.jobs = atoi(optarg) > 0 ? atoi(optarg) : 1;
+			break;
+		case 'e':
+			_options.enumerate = 1;
+			break;
+		case 'y':
+			_options.symmetry = 1;
+			break;
+		case 'c':
+			_options.cubes = atoi(optarg);
+			break;
 		default:
 			_options.help = 1;
 		}
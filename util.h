@@ -36,6 +36,7 @@
 #include <ctype.h>
 #include "graph.h"
 #include <limits.h>
+#include <pthread.h>
 
 #ifndef PATH_MAX
 	#define PATH_MAX 4096
@@ -69,10 +70,19 @@ typedef struct{
 	int threads;
 	uint writeback;
 	uint presolve;
+	uint mem_limit;		/* MiB, 0 for no limit */
+	uint binary;		/* write binary graph files */
+	uint lambda;		/* 1, or 2 for double coverings */
+	uint reduce;		/* substitute fixed edges into the LP rows */
+	uint jobs;		/* models solved in parallel */
+	uint enumerate;		/* all solutions in one search */
+	uint symmetry;		/* break the automorphisms of the base graph */
+	uint cubes;		/* variables to split an unfinished LP on */
 
 	uint quiet;
 	const char *infile;
 	const char *graph_dir;
+	const char *store;	/* classes reduced by earlier runs */
 
 	unsigned char use_default_outfile;
 	char outfile[PATH_MAX];
@@ -95,7 +105,24 @@ void args_set_forbidden();
 void *g_malloc(size_t);
 void *g_calloc(size_t, size_t);
 void *g_realloc(void*, size_t);
+#ifdef COUNT_ALLOCS
+extern volatile ulong g_allocs;
+#endif
 char *read_line(FILE*);
+uint nthreads();
+long file_bytes(FILE*);
+
+/* Start of what a runlog() record is about */
+typedef struct {
+	double wall;
+	double cpu;
+	int shared;		/* other runs in the process at the same time */
+} Runclock;
+
+void runclock_start(Runclock*);
+void runlog(const char*, Runclock*, const char*, ...);
+char *json_escape(const char*);
+void parallel_for(uint, void (*)(void*, uint), void*);
 
 
 #endif